@@ -8,11 +8,23 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/spt.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#include "vm/oom.h"
+#include "vm/rmap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -132,10 +144,24 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  cache_print_stats ();
+  dcache_print_stats ();
+  filesys_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  syscall_print_stats ();
+  pagedir_print_stats ();
+#endif
+#ifdef VM
+  frame_print_stats ();
+  rmap_print_stats ();
+  fault_around_print_stats ();
+  zero_page_print_stats ();
+  swap_print_stats ();
+  zswap_print_stats ();
+  oom_print_stats ();
 #endif
 }
@@ -0,0 +1,401 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Sector buffer cache.
+
+   All file system I/O to fs_device goes through a fixed array of
+   cached sectors, found by sector number through a hash table and
+   replaced with the clock algorithm.  Writes only mark a sector
+   dirty.  Dirty sectors are written back when they are evicted,
+   every CACHE_FLUSH_TICKS by the "cache-flush" thread, and by
+   cache_flush() from filesys_done().
+
+   cache_prefetch() queues a sector for the "cache-readahead"
+   thread, which reads it into the cache unless it is already
+   there, so that file.c can read ahead of sequential readers
+   without making them wait.
+
+   cache_lock protects the hash table and each entry's SECTOR and
+   PIN_CNT; the entry's own lock protects its data, VALID, and
+   DIRTY, and is held across disk I/O, so that threads using
+   different sectors do not wait for each other.  A pinned entry
+   is never chosen for eviction, and an entry's lock is only ever
+   held while it is pinned. */
+
+/* Number of sectors in the cache. */
+size_t cache_sectors = CACHE_DEFAULT_SECTORS;
+
+/* Ticks between write-behind passes. */
+#define CACHE_FLUSH_TICKS (TIMER_FREQ * 5)
+
+/* Maximum number of queued read-ahead requests. */
+#define PREFETCH_QUEUE_SIZE 64
+
+/* A cached sector. */
+struct cache_entry
+  {
+    struct hash_elem elem;              /* Element in cache_map. */
+    block_sector_t sector;              /* Sector held, if any. */
+    bool mapped;                        /* In cache_map? */
+    unsigned pin_cnt;                   /* Users; not evictable if > 0. */
+    bool accessed;                      /* Used since the clock passed? */
+    bool prefetched;                    /* Read ahead, not yet used? */
+    struct lock lock;                   /* Protects the fields below. */
+    bool valid;                         /* DATA holds SECTOR's contents? */
+    bool dirty;                         /* DATA newer than the disk? */
+    uint8_t *data;                      /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+static struct cache_entry *entries;     /* All cache entries. */
+static uint8_t *cache_data;             /* Their data. */
+static struct hash cache_map;           /* Entries by sector. */
+static struct lock cache_lock;          /* Protects cache_map, pins. */
+static size_t clock_hand;               /* Next eviction candidate. */
+
+/* Read-ahead requests, a ring buffer protected by prefetch_lock. */
+static block_sector_t prefetch_queue[PREFETCH_QUEUE_SIZE];
+static size_t prefetch_head;            /* Next request to serve. */
+static size_t prefetch_cnt;             /* Number of requests queued. */
+static struct lock prefetch_lock;
+static struct condition prefetch_cond;  /* Signaled when one is queued. */
+
+/* Statistics. */
+static long long hit_cnt;               /* Lookups found cached. */
+static long long miss_cnt;              /* Lookups that read the disk. */
+static long long writeback_cnt;         /* Dirty sectors written. */
+static long long ra_read_cnt;           /* Sectors read ahead. */
+static long long ra_hit_cnt;            /* ...later read or written. */
+static long long ra_unused_cnt;         /* ...evicted unused. */
+static long long ra_drop_cnt;           /* Requests dropped, queue full. */
+
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+static thread_func cache_flush_daemon NO_RETURN;
+static thread_func cache_readahead_daemon NO_RETURN;
+
+/* Initializes the buffer cache with cache_sectors entries and
+   starts its write-behind and read-ahead threads. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  if (cache_sectors == 0)
+    cache_sectors = 1;
+  entries = calloc (cache_sectors, sizeof *entries);
+  cache_data = malloc (cache_sectors * BLOCK_SECTOR_SIZE);
+  if (entries == NULL || cache_data == NULL)
+    PANIC ("cannot allocate %zu-sector buffer cache", cache_sectors);
+
+  hash_init (&cache_map, cache_hash, cache_less, NULL);
+  lock_init (&cache_lock);
+  for (i = 0; i < cache_sectors; i++)
+    {
+      lock_init (&entries[i].lock);
+      entries[i].data = cache_data + i * BLOCK_SECTOR_SIZE;
+    }
+  lock_init (&prefetch_lock);
+  cond_init (&prefetch_cond);
+  thread_create ("cache-flush", PRI_DEFAULT, cache_flush_daemon, NULL);
+  thread_create ("cache-readahead", PRI_DEFAULT, cache_readahead_daemon,
+                 NULL);
+}
+
+/* Writes E's data back to disk if it is dirty.
+   E's lock must be held. */
+static void
+write_back (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&e->lock));
+  if (e->valid && e->dirty)
+    {
+      block_write (fs_device, e->sector, e->data);
+      e->dirty = false;
+      writeback_cnt++;
+    }
+}
+
+/* Releases an entry returned by cache_get(). */
+static void
+cache_put (struct cache_entry *e)
+{
+  lock_release (&e->lock);
+  lock_acquire (&cache_lock);
+  e->pin_cnt--;
+  lock_release (&cache_lock);
+}
+
+/* Returns an unpinned entry to reuse, advancing the clock hand
+   past recently used entries.  Returns a null pointer if every
+   entry is pinned.  cache_lock must be held. */
+static struct cache_entry *
+pick_victim (void)
+{
+  size_t n;
+
+  for (n = 0; n < 2 * cache_sectors; n++)
+    {
+      struct cache_entry *e = &entries[clock_hand];
+      clock_hand = (clock_hand + 1) % cache_sectors;
+      if (e->pin_cnt > 0)
+        continue;
+      if (!e->accessed)
+        return e;
+      e->accessed = false;
+    }
+  return NULL;
+}
+
+/* Returns the entry for SECTOR, pinned and locked, reading the
+   sector from disk unless OVERWRITE is true, in which case the
+   caller is about to replace all of its data.  Release it with
+   cache_put().
+
+   If PREFETCH is true, the sector is being read ahead: returns a
+   null pointer at once if it is already cached. */
+static struct cache_entry *
+cache_get (block_sector_t sector, bool overwrite, bool prefetch)
+{
+  struct cache_entry key, *e;
+  struct hash_elem *found;
+
+  key.sector = sector;
+  for (;;)
+    {
+      lock_acquire (&cache_lock);
+      found = hash_find (&cache_map, &key.elem);
+      if (found != NULL)
+        {
+          e = hash_entry (found, struct cache_entry, elem);
+          if (prefetch)
+            {
+              lock_release (&cache_lock);
+              return NULL;
+            }
+          if (e->prefetched)
+            {
+              e->prefetched = false;
+              ra_hit_cnt++;
+            }
+          e->pin_cnt++;
+          e->accessed = true;
+          hit_cnt++;
+          lock_release (&cache_lock);
+          lock_acquire (&e->lock);
+          return e;
+        }
+
+      e = pick_victim ();
+      if (e == NULL)
+        {
+          /* Every entry is in use; wait for one to come free. */
+          lock_release (&cache_lock);
+          thread_yield ();
+          continue;
+        }
+
+      /* Nobody holds the lock of an unpinned entry, so this does
+         not block while we hold cache_lock. */
+      e->pin_cnt++;
+      lock_acquire (&e->lock);
+      if (e->valid && e->dirty)
+        {
+          /* Write the old sector back while it is still findable,
+             so that a reader of it waits for the write instead of
+             reading stale data from disk, then start over. */
+          lock_release (&cache_lock);
+          write_back (e);
+          cache_put (e);
+          continue;
+        }
+
+      if (e->mapped)
+        hash_delete (&cache_map, &e->elem);
+      if (e->prefetched)
+        ra_unused_cnt++;
+      e->sector = sector;
+      e->mapped = true;
+      e->accessed = true;
+      e->prefetched = prefetch;
+      e->valid = false;
+      hash_insert (&cache_map, &e->elem);
+      if (prefetch)
+        ra_read_cnt++;
+      else
+        miss_cnt++;
+      lock_release (&cache_lock);
+
+      if (!overwrite)
+        block_read (fs_device, sector, e->data);
+      e->valid = true;
+      return e;
+    }
+}
+
+/* Reads SECTOR into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes. */
+void
+cache_read (block_sector_t sector, void *buffer)
+{
+  cache_read_at (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads SIZE bytes starting at byte OFS within SECTOR into
+   BUFFER. */
+void
+cache_read_at (block_sector_t sector, void *buffer, size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+  e = cache_get (sector, false, false);
+  memcpy (buffer, e->data + ofs, size);
+  cache_put (e);
+}
+
+/* Writes BLOCK_SECTOR_SIZE bytes from BUFFER to SECTOR. */
+void
+cache_write (block_sector_t sector, const void *buffer)
+{
+  cache_write_at (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Writes SIZE bytes from BUFFER to SECTOR, starting at byte OFS
+   within it.  The write reaches the disk later. */
+void
+cache_write_at (block_sector_t sector, const void *buffer,
+                size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+  e = cache_get (sector, ofs == 0 && size == BLOCK_SECTOR_SIZE, false);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  cache_put (e);
+}
+
+/* Asks the read-ahead thread to bring SECTOR into the cache, and
+   returns without waiting for it.  The request is dropped if too
+   many are already queued. */
+void
+cache_prefetch (block_sector_t sector)
+{
+  lock_acquire (&prefetch_lock);
+  if (prefetch_cnt < PREFETCH_QUEUE_SIZE)
+    {
+      size_t tail = (prefetch_head + prefetch_cnt) % PREFETCH_QUEUE_SIZE;
+      prefetch_queue[tail] = sector;
+      prefetch_cnt++;
+      cond_signal (&prefetch_cond, &prefetch_lock);
+    }
+  else
+    ra_drop_cnt++;
+  lock_release (&prefetch_lock);
+}
+
+/* Returns true if SECTOR is in the cache, without reading it or
+   counting a lookup.  It may be evicted again at any time. */
+bool
+cache_contains (block_sector_t sector)
+{
+  struct cache_entry key;
+  bool found;
+
+  key.sector = sector;
+  lock_acquire (&cache_lock);
+  found = hash_find (&cache_map, &key.elem) != NULL;
+  lock_release (&cache_lock);
+  return found;
+}
+
+/* Writes every dirty sector back to disk. */
+void
+cache_flush (void)
+{
+  size_t i;
+
+  for (i = 0; i < cache_sectors; i++)
+    {
+      struct cache_entry *e = &entries[i];
+
+      lock_acquire (&cache_lock);
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      lock_acquire (&e->lock);
+      write_back (e);
+      cache_put (e);
+    }
+}
+
+/* Write-behind thread: flushes dirty sectors periodically, so
+   that a crash loses at most CACHE_FLUSH_TICKS of writes. */
+static void
+cache_flush_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (CACHE_FLUSH_TICKS);
+      cache_flush ();
+    }
+}
+
+/* Read-ahead thread: serves cache_prefetch() requests in order. */
+static void
+cache_readahead_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      block_sector_t sector;
+      struct cache_entry *e;
+
+      lock_acquire (&prefetch_lock);
+      while (prefetch_cnt == 0)
+        cond_wait (&prefetch_cond, &prefetch_lock);
+      sector = prefetch_queue[prefetch_head];
+      prefetch_head = (prefetch_head + 1) % PREFETCH_QUEUE_SIZE;
+      prefetch_cnt--;
+      lock_release (&prefetch_lock);
+
+      e = cache_get (sector, false, true);
+      if (e != NULL)
+        cache_put (e);
+    }
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  printf ("Cache: %lld hits, %lld misses, %lld writebacks\n",
+          hit_cnt, miss_cnt, writeback_cnt);
+  printf ("Read-ahead: %lld sectors read, %lld used, %lld unused, "
+          "%lld requests dropped\n",
+          ra_read_cnt, ra_hit_cnt, ra_unused_cnt, ra_drop_cnt);
+}
+
+/* Returns a hash value for cache entry E. */
+static unsigned
+cache_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct cache_entry *ce = hash_entry (e, struct cache_entry, elem);
+  return hash_int (ce->sector);
+}
+
+/* Returns true if cache entry A precedes cache entry B. */
+static bool
+cache_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct cache_entry, elem)->sector
+          < hash_entry (b, struct cache_entry, elem)->sector);
+}
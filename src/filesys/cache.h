@@ -0,0 +1,25 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Default number of sectors in the buffer cache.
+   Overridden by the "-cache=COUNT" kernel option. */
+#define CACHE_DEFAULT_SECTORS 64
+
+extern size_t cache_sectors;
+
+void cache_init (void);
+void cache_read (block_sector_t, void *buffer);
+void cache_read_at (block_sector_t, void *buffer, size_t ofs, size_t size);
+void cache_write (block_sector_t, const void *buffer);
+void cache_write_at (block_sector_t, const void *buffer,
+                     size_t ofs, size_t size);
+void cache_prefetch (block_sector_t);
+bool cache_contains (block_sector_t);
+void cache_flush (void);
+void cache_print_stats (void);
+
+#endif /* filesys/cache.h */
@@ -0,0 +1,196 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Remembers the results of recent directory lookups, keyed by
+   the directory's inode sector and the name looked up, so that
+   opening the same name again does not read the directory.  An
+   entry is positive, holding the sector of the named file's
+   inode, or negative, recording that the directory has no such
+   name, which is held as sector 0 since that is always the free
+   map's inode.
+
+   directory.c adds an entry for each name it looks up, adds or
+   removes, so that the cache never disagrees with the disk, and
+   forgets all of a directory's entries when its sector is reused
+   for a new directory.  The cache holds at most
+   DCACHE_MAX_ENTRIES and replaces the least recently used entry
+   when full, or when memory for a new one cannot be had, so it
+   gives up memory rather than taking more under pressure. */
+
+/* A cached lookup. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentry_map. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    block_sector_t dir;                 /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Name looked up. */
+    block_sector_t sector;              /* File's inode, 0 if none. */
+  };
+
+static struct hash dentry_map;          /* Entries by (DIR, NAME). */
+static struct list lru_list;            /* Entries, most recent first. */
+static size_t dentry_cnt;               /* Number of entries. */
+static struct lock dcache_lock;         /* Protects all of the above. */
+
+/* Statistics. */
+static long long hit_cnt;               /* Lookups answered positively. */
+static long long negative_hit_cnt;      /* Lookups answered negatively. */
+static long long miss_cnt;              /* Lookups not cached. */
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  hash_init (&dentry_map, dentry_hash, dentry_less, NULL);
+  list_init (&lru_list);
+  lock_init (&dcache_lock);
+}
+
+/* Returns the entry for NAME in the directory whose inode is in
+   sector DIR, or a null pointer if there is none.  Must be called
+   with dcache_lock held. */
+static struct dentry *
+find (block_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentry_map, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   Returns false if the result is not cached.  Otherwise, returns
+   true and stores the sector of the named file's inode in
+   *SECTORP, or 0 if DIR has no file named NAME. */
+bool
+dcache_lookup (block_sector_t dir, const char *name,
+               block_sector_t *sectorp)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    {
+      list_remove (&d->lru_elem);
+      list_push_front (&lru_list, &d->lru_elem);
+      *sectorp = d->sector;
+      if (d->sector != 0)
+        hit_cnt++;
+      else
+        negative_hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+  return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector DIR
+   names the file whose inode is in SECTOR, or no file if SECTOR
+   is 0, replacing any entry for NAME already cached. */
+void
+dcache_insert (block_sector_t dir, const char *name, block_sector_t sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    list_remove (&d->lru_elem);
+  else
+    {
+      d = dentry_cnt < DCACHE_MAX_ENTRIES ? malloc (sizeof *d) : NULL;
+      if (d != NULL)
+        dentry_cnt++;
+      else if (!list_empty (&lru_list))
+        {
+          /* Reuse the least recently used entry. */
+          d = list_entry (list_pop_back (&lru_list), struct dentry, lru_elem);
+          hash_delete (&dentry_map, &d->hash_elem);
+        }
+      else
+        {
+          lock_release (&dcache_lock);
+          return;
+        }
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dentry_map, &d->hash_elem);
+    }
+  d->sector = sector;
+  list_push_front (&lru_list, &d->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets every entry for the directory whose inode is in sector
+   DIR. */
+void
+dcache_invalidate_dir (block_sector_t dir)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&dcache_lock);
+  for (e = list_begin (&lru_list); e != list_end (&lru_list); e = next)
+    {
+      struct dentry *d = list_entry (e, struct dentry, lru_elem);
+      next = list_next (e);
+      if (d->dir == dir)
+        {
+          list_remove (&d->lru_elem);
+          hash_delete (&dentry_map, &d->hash_elem);
+          free (d);
+          dentry_cnt--;
+        }
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dentry cache: %lld hits, %lld negative hits, %lld misses\n",
+          hit_cnt, negative_hit_cnt, miss_cnt);
+}
+
+/* Returns a hash of dentry E's directory and name. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
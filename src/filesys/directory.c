@@ -1,7 +1,10 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -21,12 +24,169 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* A directory file is made of sector-sized blocks.  Block 0 holds
+   a struct dir_header.  A small directory is linear: blocks 1 and
+   up hold entries, and finding a name means reading all of them.
+   Once a linear directory would outgrow DIR_LINEAR_BLOCKS blocks,
+   it is converted to an extendible hash table: blocks 1 through
+   DIR_TABLE_BLOCKS hold a table, indexed by the low DEPTH bits of
+   a name's hash, of the bucket blocks that follow it.  A bucket
+   that fills is split in two, doubling the table first if
+   needed, so finding a name reads one table entry and one
+   bucket. */
+#define DIR_MAGIC 0x44495248            /* Identifies a directory. */
+#define DIR_LINEAR_BLOCKS 4             /* Largest linear directory. */
+#define DIR_MAX_DEPTH 12                /* Most hash bits used. */
+#define DIR_TABLE_BLOCKS \
+        ((1 << DIR_MAX_DEPTH) * sizeof (uint16_t) / BLOCK_SECTOR_SIZE)
+#define DIR_FIRST_BUCKET (1 + DIR_TABLE_BLOCKS)
+
+/* Directory header, in block 0. */
+struct dir_header
+  {
+    unsigned magic;                     /* DIR_MAGIC. */
+    int depth;                          /* Hash bits used, -1 if linear. */
+    uint32_t block_cnt;                 /* Blocks in use, with this one. */
+    uint32_t free_hint;                 /* Linear: first block that may
+                                           have a free entry. */
+  };
+
+/* Entries in one block, leaving room for a bucket's depth. */
+#define DIR_SLOTS \
+        ((BLOCK_SECTOR_SIZE - sizeof (uint32_t)) / sizeof (struct dir_entry))
+
+/* A block of entries: a linear directory block or a bucket. */
+struct dir_block
+  {
+    struct dir_entry entries[DIR_SLOTS]; /* Entries. */
+    uint32_t depth;                     /* Bucket: hash bits its
+                                           entries have in common. */
+  };
+
+/* Returns the byte offset of entry SLOT in block BLOCK. */
+static off_t
+entry_ofs (uint32_t block, size_t slot)
+{
+  return block * BLOCK_SECTOR_SIZE + slot * sizeof (struct dir_entry);
+}
+
+/* Reads DIR's header into *H.  Returns true if successful. */
+static bool
+read_header (const struct dir *dir, struct dir_header *h)
+{
+  return (inode_read_at (dir->inode, h, sizeof *h, 0) == sizeof *h
+          && h->magic == DIR_MAGIC);
+}
+
+/* Writes *H as DIR's header.  Returns true if successful. */
+static bool
+write_header (struct dir *dir, const struct dir_header *h)
+{
+  return inode_write_at (dir->inode, h, sizeof *h, 0) == sizeof *h;
+}
+
+/* Reads block BLOCK of DIR into *B.  Returns true if
+   successful. */
+static bool
+read_block (const struct dir *dir, uint32_t block, struct dir_block *b)
+{
+  return (inode_read_at (dir->inode, b, sizeof *b, entry_ofs (block, 0))
+          == sizeof *b);
+}
+
+/* Writes *B as block BLOCK of DIR, extending DIR if needed.
+   Returns true if successful. */
+static bool
+write_block (struct dir *dir, uint32_t block, const struct dir_block *b)
+{
+  return (inode_write_at (dir->inode, b, sizeof *b, entry_ofs (block, 0))
+          == sizeof *b);
+}
+
+/* Writes *E as entry SLOT of block BLOCK of DIR.  Returns true
+   if successful. */
+static bool
+write_entry (struct dir *dir, uint32_t block, size_t slot,
+             const struct dir_entry *e)
+{
+  return (inode_write_at (dir->inode, e, sizeof *e, entry_ofs (block, slot))
+          == sizeof *e);
+}
+
+/* Returns the slot of the entry in use in B named NAME, or the
+   first free slot if NAME is a null pointer, or -1 if there is
+   none. */
+static int
+find_slot (const struct dir_block *b, const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < DIR_SLOTS; i++)
+    if (name != NULL
+        ? b->entries[i].in_use && !strcmp (name, b->entries[i].name)
+        : !b->entries[i].in_use)
+      return i;
+  return -1;
+}
+
+/* Returns entry IDX of DIR's hash table. */
+static uint32_t
+table_get (const struct dir *dir, uint32_t idx)
+{
+  uint16_t block = 0;
+  inode_read_at (dir->inode, &block, sizeof block,
+                 BLOCK_SECTOR_SIZE + idx * sizeof block);
+  return block;
+}
+
+/* Sets entry IDX of DIR's hash table to BLOCK. */
+static void
+table_set (struct dir *dir, uint32_t idx, uint32_t block)
+{
+  uint16_t value = block;
+  inode_write_at (dir->inode, &value, sizeof value,
+                  BLOCK_SECTOR_SIZE + idx * sizeof value);
+}
+
+/* Returns the index into a hash table DEPTH bits deep for a name
+   whose hash is HASH. */
+static uint32_t
+table_idx (unsigned hash, int depth)
+{
+  return hash & ((1u << depth) - 1);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (block_sector_t sector, size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  size_t blocks = DIV_ROUND_UP (entry_cnt, DIR_SLOTS);
+  struct dir_header h;
+  struct dir *dir;
+  bool success;
+
+  /* SECTOR may have held a directory that has been removed. */
+  dcache_invalidate_dir (sector);
+
+  if (blocks == 0)
+    blocks = 1;
+  else if (blocks > DIR_LINEAR_BLOCKS)
+    blocks = DIR_LINEAR_BLOCKS;
+  if (!inode_create (sector, (1 + blocks) * BLOCK_SECTOR_SIZE))
+    return false;
+
+  /* The blocks are zeroed, so every entry is free. */
+  dir = dir_open (inode_open (sector));
+  if (dir == NULL)
+    return false;
+  h.magic = DIR_MAGIC;
+  h.depth = -1;
+  h.block_cnt = 1 + blocks;
+  h.free_hint = 1;
+  success = write_header (dir, &h);
+  dir_close (dir);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -92,23 +252,70 @@ static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
-  struct dir_entry e;
-  size_t ofs;
+  struct dir_header h;
+  struct dir_block *b;
+  uint32_t block, end;
+  bool found = false;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
+  if (!read_header (dir, &h))
+    return false;
+  if (h.depth < 0)
+    {
+      block = 1;
+      end = h.block_cnt;
+    }
+  else
+    {
+      block = table_get (dir, table_idx (hash_string (name), h.depth));
+      end = block + 1;
+    }
+
+  b = malloc (sizeof *b);
+  if (b == NULL)
+    return false;
+  for (; block < end && !found; block++)
+    if (read_block (dir, block, b))
       {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
+        int slot = find_slot (b, name);
+        if (slot >= 0)
+          {
+            if (ep != NULL)
+              *ep = b->entries[slot];
+            if (ofsp != NULL)
+              *ofsp = entry_ofs (block, slot);
+            found = true;
+          }
       }
-  return false;
+  free (b);
+  return found;
+}
+
+/* Searches DIR for a file with the given NAME, consulting the
+   directory entry cache first and filling it in afterward.
+   Returns true if the search succeeded, in which case *SECTORP
+   is the sector of the file's inode, or 0 if there is no file
+   named NAME.  Returns false if DIR could not be read. */
+static bool
+cached_lookup (const struct dir *dir, const char *name,
+               block_sector_t *sectorp)
+{
+  block_sector_t dir_sector = inode_get_inumber (dir->inode);
+  struct dir_header h;
+  struct dir_entry e;
+
+  if (dcache_lookup (dir_sector, name, sectorp))
+    return true;
+  if (lookup (dir, name, &e, NULL))
+    *sectorp = e.inode_sector;
+  else if (read_header (dir, &h))
+    *sectorp = 0;
+  else
+    return false;
+  dcache_insert (dir_sector, name, *sectorp);
+  return true;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -119,19 +326,237 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
-  struct dir_entry e;
+  block_sector_t sector;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  *inode = NULL;
+  if (cached_lookup (dir, name, &sector) && sector != 0)
+    *inode = inode_open (sector);
 
   return *inode != NULL;
 }
 
+/* Splits bucket B, block BLOCK of hashed directory DIR with
+   header *H, in two.  IDX is a hash table index that maps to B.
+   Doubles the hash table first if B's depth is already the
+   table's.  Updates *H, which the caller must write back.
+   Returns true if successful, false if the table is as deep as
+   it can be or the disk is full. */
+static bool
+split (struct dir *dir, struct dir_header *h, uint32_t idx,
+       uint32_t block, struct dir_block *b)
+{
+  uint32_t depth = b->depth;
+  uint32_t new_block = h->block_cnt;
+  struct dir_block *nb;
+  uint32_t i;
+  bool success = false;
+
+  if ((int) depth == h->depth)
+    {
+      /* The new half of the table maps to the same buckets as the
+         old half.  It is not used until the header is written. */
+      if (h->depth == DIR_MAX_DEPTH)
+        return false;
+      for (i = 0; i < 1u << depth; i++)
+        table_set (dir, i + (1u << depth), table_get (dir, i));
+      h->depth++;
+    }
+
+  nb = calloc (1, sizeof *nb);
+  if (nb == NULL)
+    return false;
+
+  /* Move the entries whose next hash bit is set. */
+  for (i = 0; i < DIR_SLOTS; i++)
+    if (b->entries[i].in_use
+        && (hash_string (b->entries[i].name) >> depth) & 1)
+      {
+        nb->entries[i] = b->entries[i];
+        b->entries[i].in_use = false;
+      }
+  nb->depth = b->depth = depth + 1;
+
+  if (write_block (dir, new_block, nb) && write_block (dir, block, b))
+    {
+      /* Of the table entries that map to B, those whose next bit
+         is set now map to the new bucket. */
+      for (i = table_idx (idx, depth); i < 1u << h->depth; i += 1u << depth)
+        if ((i >> depth) & 1)
+          table_set (dir, i, new_block);
+      h->block_cnt++;
+      success = true;
+    }
+  free (nb);
+  return success;
+}
+
+/* Adds *E to hashed directory DIR with header *H, splitting
+   buckets as needed.  Updates *H but does not write it back.
+   Returns true if successful. */
+static bool
+hashed_insert (struct dir *dir, struct dir_header *h,
+               const struct dir_entry *e)
+{
+  unsigned hash = hash_string (e->name);
+  struct dir_block *b = malloc (sizeof *b);
+  bool success = false;
+
+  if (b == NULL)
+    return false;
+  for (;;)
+    {
+      uint32_t idx = table_idx (hash, h->depth);
+      uint32_t block = table_get (dir, idx);
+      int slot;
+
+      if (!read_block (dir, block, b))
+        break;
+      slot = find_slot (b, NULL);
+      if (slot >= 0)
+        {
+          success = write_entry (dir, block, slot, e);
+          break;
+        }
+      if (!split (dir, h, idx, block, b))
+        break;
+    }
+  free (b);
+  return success;
+}
+
+/* Adds *E to hashed directory DIR with header *H, splitting
+   buckets as needed, and writes back *H if that changed it.
+   Returns true if successful. */
+static bool
+hashed_add (struct dir *dir, struct dir_header *h,
+            const struct dir_entry *e)
+{
+  uint32_t block_cnt = h->block_cnt;
+  bool success = hashed_insert (dir, h, e);
+
+  /* A split changes the table and buckets even if the add then
+     fails, so the header must follow. */
+  if (h->block_cnt != block_cnt && !write_header (dir, h))
+    success = false;
+  return success;
+}
+
+/* Converts linear directory DIR with header *H, whose blocks are
+   all full, into a hashed directory.  The table and buckets are
+   built before the header is written, and if that fails the
+   linear blocks are written back, so that a failed conversion
+   leaves DIR as it was.  Returns true if successful. */
+static bool
+convert (struct dir *dir, struct dir_header *h)
+{
+  size_t blocks = h->block_cnt - 1;
+  struct dir_header nh = *h;
+  struct dir_block *old, *b;
+  size_t i, j;
+  bool success = false;
+
+  old = malloc (blocks * sizeof *old);
+  b = calloc (1, sizeof *b);
+  if (old == NULL || b == NULL)
+    goto done;
+  for (i = 0; i < blocks; i++)
+    if (!read_block (dir, i + 1, &old[i]))
+      goto done;
+
+  /* Grow the file to hold twice as many buckets as the entries
+     fill before touching the linear blocks, so that the splits
+     below are unlikely to run out of disk space. */
+  if (!write_block (dir, DIR_FIRST_BUCKET + 2 * blocks - 1, b)
+      || !write_block (dir, DIR_FIRST_BUCKET, b))
+    goto done;
+
+  /* Start with a single bucket and add the entries back.  The
+     table overwrites the linear blocks, but the header still
+     says DIR is linear until all of them are in. */
+  table_set (dir, 0, DIR_FIRST_BUCKET);
+  nh.depth = 0;
+  nh.block_cnt = DIR_FIRST_BUCKET + 1;
+  success = true;
+  for (i = 0; i < blocks && success; i++)
+    for (j = 0; j < DIR_SLOTS && success; j++)
+      if (old[i].entries[j].in_use
+          && !hashed_insert (dir, &nh, &old[i].entries[j]))
+        success = false;
+  if (success && write_header (dir, &nh))
+    *h = nh;
+  else
+    {
+      success = false;
+      for (i = 0; i < blocks; i++)
+        write_block (dir, i + 1, &old[i]);
+      write_header (dir, h);
+    }
+
+ done:
+  free (b);
+  free (old);
+  return success;
+}
+
+/* Adds *E to linear directory DIR with header *H, starting the
+   search for a free entry at the block H's hint names.  Appends a
+   block if all are full, or converts DIR to a hashed directory
+   if it has as many blocks as a linear directory may.  Returns
+   true if successful. */
+static bool
+linear_add (struct dir *dir, struct dir_header *h,
+            const struct dir_entry *e)
+{
+  struct dir_block *b = malloc (sizeof *b);
+  uint32_t block;
+  bool changed = false;
+  bool success = false;
+
+  if (b == NULL)
+    return false;
+  for (block = h->free_hint; block < h->block_cnt; block++)
+    {
+      int slot;
+      if (!read_block (dir, block, b))
+        goto done;
+      slot = find_slot (b, NULL);
+      if (slot >= 0)
+        {
+          success = write_entry (dir, block, slot, e);
+          goto done;
+        }
+    }
+
+  if (h->block_cnt - 1 < DIR_LINEAR_BLOCKS)
+    {
+      memset (b, 0, sizeof *b);
+      b->entries[0] = *e;
+      success = write_block (dir, block, b);
+      if (success)
+        {
+          h->block_cnt++;
+          changed = true;
+        }
+    }
+  else
+    {
+      success = convert (dir, h) && hashed_add (dir, h, e);
+      goto done;
+    }
+
+ done:
+  if (h->depth < 0 && (changed || block != h->free_hint))
+    {
+      h->free_hint = block;
+      write_header (dir, h);
+    }
+  free (b);
+  return success;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
@@ -141,9 +566,10 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
+  struct dir_header h;
   struct dir_entry e;
-  off_t ofs;
-  bool success = false;
+  block_sector_t sector;
+  bool success;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
@@ -153,28 +579,18 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
     return false;
 
   /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
-    goto done;
+  if (!cached_lookup (dir, name, &sector) || sector != 0
+      || !read_header (dir, &h))
+    return false;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
-
-  /* Write slot. */
+  memset (&e, 0, sizeof e);
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-
- done:
+  success = (h.depth < 0
+             ? linear_add (dir, &h, &e) : hashed_add (dir, &h, &e));
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
   return success;
 }
 
@@ -184,6 +600,7 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
+  struct dir_header h;
   struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
@@ -206,8 +623,17 @@ dir_remove (struct dir *dir, const char *name)
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
 
+  /* Let dir_add() find the free entry. */
+  if (read_header (dir, &h) && h.depth < 0
+      && (uint32_t) ofs / BLOCK_SECTOR_SIZE < h.free_hint)
+    {
+      h.free_hint = ofs / BLOCK_SECTOR_SIZE;
+      write_header (dir, &h);
+    }
+
   /* Remove inode. */
   inode_remove (inode);
+  dcache_insert (inode_get_inumber (dir->inode), name, 0);
   success = true;
 
  done:
@@ -221,10 +647,27 @@ dir_remove (struct dir *dir, const char *name)
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
+  struct dir_header h;
   struct dir_entry e;
+  off_t first, end;
+
+  if (!read_header (dir, &h))
+    return false;
+  first = entry_ofs (h.depth < 0 ? 1 : DIR_FIRST_BUCKET, 0);
+  end = entry_ofs (h.block_cnt, 0);
+  if (dir->pos < first)
+    dir->pos = first;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  while (dir->pos < end)
     {
+      /* Skip the unused tail of each block. */
+      if ((dir->pos % BLOCK_SECTOR_SIZE) / sizeof e >= DIR_SLOTS)
+        {
+          dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+          continue;
+        }
+      if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+        break;
       dir->pos += sizeof e;
       if (e.in_use)
         {
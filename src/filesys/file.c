@@ -1,16 +1,29 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "devices/block.h"
 #include "threads/malloc.h"
 
+/* Read-ahead window for sequential file_read()s, in sectors.  It
+   starts at RA_MIN_SECTORS, doubles with each further sequential
+   read up to RA_MAX_SECTORS, and drops to zero on any read that
+   does not start where the previous one ended. */
+#define RA_MIN_SECTORS 4
+#define RA_MAX_SECTORS 32
+
 /* An open file. */
 struct file 
   {
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    off_t ra_next;              /* Where a sequential read would start. */
+    off_t ra_end;               /* End of the data read ahead so far. */
+    int ra_window;              /* Read-ahead window, in sectors. */
   };
 
+static void read_ahead (struct file *, off_t offset, off_t size);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -69,10 +82,48 @@ off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  read_ahead (file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
 
+/* Updates FILE's read-ahead window for a read of SIZE bytes at
+   OFFSET and, if the reads are sequential, starts reading the
+   window past it into the cache in the background. */
+static void
+read_ahead (struct file *file, off_t offset, off_t size)
+{
+  off_t target;
+
+  if (size == 0)
+    return;
+  if (offset == file->ra_next)
+    {
+      if (file->ra_window == 0)
+        file->ra_window = RA_MIN_SECTORS;
+      else if (file->ra_window < RA_MAX_SECTORS)
+        file->ra_window *= 2;
+    }
+  else
+    {
+      file->ra_window = 0;
+      file->ra_end = 0;
+    }
+  file->ra_next = offset + size;
+  if (file->ra_window == 0)
+    return;
+
+  /* Request only what earlier reads have not. */
+  if (file->ra_end < file->ra_next)
+    file->ra_end = file->ra_next;
+  target = file->ra_next + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (file->ra_end < target)
+    {
+      inode_read_ahead (file->inode, file->ra_end, target - file->ra_end);
+      file->ra_end = target;
+    }
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
@@ -86,10 +137,9 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
+   Grows the file if the write extends past its end.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -101,10 +151,9 @@ file_write (struct file *file, const void *buffer, off_t size)
 
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
+   Grows the file if the write extends past its end.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
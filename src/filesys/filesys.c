@@ -2,6 +2,8 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
@@ -10,7 +12,13 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Files in the root directory at shutdown and the extents,
+   runs of consecutive sectors, that their data occupies. */
+static size_t file_cnt;
+static size_t extent_cnt;
+
 static void do_format (void);
+static void count_extents (void);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -21,7 +29,9 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
   inode_init ();
+  dcache_init ();
   free_map_init ();
 
   if (format) 
@@ -35,7 +45,9 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  count_extents ();
   free_map_close ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -54,6 +66,7 @@ filesys_create (const char *name, off_t initial_size)
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  free_map_flush ();
 
   return success;
 }
@@ -90,6 +103,36 @@ filesys_remove (const char *name)
   return success;
 }
 
+/* Counts the files in the root directory and the extents they
+   occupy, a measure of how fragmented the disk has become. */
+static void
+count_extents (void)
+{
+  struct dir *dir = dir_open_root ();
+  char name[NAME_MAX + 1];
+
+  if (dir == NULL)
+    return;
+  while (dir_readdir (dir, name))
+    {
+      struct inode *inode;
+      if (dir_lookup (dir, name, &inode))
+        {
+          file_cnt++;
+          extent_cnt += inode_extent_cnt (inode);
+          inode_close (inode);
+        }
+    }
+  dir_close (dir);
+}
+
+/* Prints file system statistics. */
+void
+filesys_print_stats (void) 
+{
+  printf ("File system: %zu files in %zu extents\n", file_cnt, extent_cnt);
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
@@ -13,6 +13,7 @@ extern struct block *fs_device;
 
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_print_stats (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
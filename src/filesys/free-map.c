@@ -1,12 +1,211 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <list.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/malloc.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *dirty;         /* Free map file sectors changed
+                                        since the last flush. */
+
+/* Bits of the free map held by one sector of its file. */
+#define SECTOR_BITS (BLOCK_SECTOR_SIZE * 8)
+
+/* Free space is also indexed as extents, runs of free sectors,
+   so that allocation does not have to scan the bitmap.  The
+   bitmap is what goes to disk; the extents are rebuilt from it
+   whenever it is read. */
+struct extent
+  {
+    struct list_elem elem;              /* In `extents'. */
+    struct list_elem bucket_elem;       /* In one of `buckets'. */
+    block_sector_t start;               /* First free sector. */
+    size_t cnt;                         /* Number of free sectors. */
+  };
+
+/* Bucket I holds the extents of 2**I to 2**(I+1) - 1 sectors,
+   except that the last bucket holds all larger extents too. */
+#define BUCKET_CNT 16
+
+static struct list extents;             /* All extents, by start. */
+static struct list buckets[BUCKET_CNT]; /* Extents by size. */
+
+/* True if the extents do not describe the bitmap, because memory
+   ran out while updating them.  Allocation then rebuilds them,
+   or scans the bitmap if that fails too. */
+static bool extents_stale;
+
+/* Returns the bucket for an extent of CNT sectors. */
+static size_t
+bucket_of (size_t cnt)
+{
+  size_t bucket = 0;
+
+  ASSERT (cnt > 0);
+  while (cnt > 1 && bucket < BUCKET_CNT - 1)
+    {
+      cnt >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Sets extent E to START and CNT and files it in the matching
+   bucket, or frees it if CNT is 0.  E must not be in a bucket. */
+static void
+extent_set (struct extent *e, block_sector_t start, size_t cnt)
+{
+  if (cnt == 0)
+    {
+      list_remove (&e->elem);
+      free (e);
+      return;
+    }
+  e->start = start;
+  e->cnt = cnt;
+  list_push_front (&buckets[bucket_of (cnt)], &e->bucket_elem);
+}
+
+/* Discards every extent. */
+static void
+extents_clear (void)
+{
+  size_t i;
+
+  for (i = 0; i < BUCKET_CNT; i++)
+    list_init (&buckets[i]);
+  while (!list_empty (&extents))
+    free (list_entry (list_pop_front (&extents), struct extent, elem));
+}
+
+/* Rebuilds the extents from the bitmap. */
+static void
+extents_build (void)
+{
+  size_t size = bitmap_size (free_map);
+  size_t start = 0;
+
+  extents_clear ();
+  extents_stale = false;
+  while ((start = bitmap_scan (free_map, start, 1, false)) != BITMAP_ERROR)
+    {
+      size_t end = bitmap_scan (free_map, start, 1, true);
+      struct extent *e = malloc (sizeof *e);
+      if (end == BITMAP_ERROR)
+        end = size;
+      if (e == NULL)
+        {
+          extents_clear ();
+          extents_stale = true;
+          return;
+        }
+      list_push_back (&extents, &e->elem);
+      extent_set (e, start, end - start);
+      start = end;
+    }
+}
+
+/* Returns the first extent that ends after SECTOR, or the first
+   extent if there is none, or a null pointer if no sector is
+   free. */
+static struct extent *
+extent_after (block_sector_t sector)
+{
+  struct list_elem *elem;
+
+  for (elem = list_begin (&extents); elem != list_end (&extents);
+       elem = list_next (elem))
+    {
+      struct extent *e = list_entry (elem, struct extent, elem);
+      if (e->start + e->cnt > sector)
+        return e;
+    }
+  return (!list_empty (&extents)
+          ? list_entry (list_front (&extents), struct extent, elem)
+          : NULL);
+}
+
+/* Returns the smallest extent of at least CNT sectors, or a null
+   pointer if there is none. */
+static struct extent *
+extent_best_fit (size_t cnt)
+{
+  size_t bucket;
+
+  for (bucket = bucket_of (cnt); bucket < BUCKET_CNT; bucket++)
+    {
+      struct extent *best = NULL;
+      struct list_elem *elem;
+
+      for (elem = list_begin (&buckets[bucket]);
+           elem != list_end (&buckets[bucket]); elem = list_next (elem))
+        {
+          struct extent *e = list_entry (elem, struct extent, bucket_elem);
+          if (e->cnt >= cnt && (best == NULL || e->cnt < best->cnt))
+            best = e;
+        }
+      if (best != NULL)
+        return best;
+    }
+  return NULL;
+}
+
+/* Sets CNT sectors starting at SECTOR to VALUE in the bitmap and
+   notes which sectors of the free map file need writing. */
+static void
+mark (block_sector_t sector, size_t cnt, bool value)
+{
+  size_t first = sector / SECTOR_BITS;
+  size_t last = (sector + cnt - 1) / SECTOR_BITS;
+
+  bitmap_set_multiple (free_map, sector, cnt, value);
+  bitmap_set_multiple (dirty, first, last - first + 1, true);
+}
+
+/* Allocates CNT sectors starting at SECTOR, which must all lie in
+   extent E, and removes them from E.  SPARE must be a free
+   extent if taking them splits E in two, and is freed otherwise. */
+static void
+take (struct extent *e, block_sector_t sector, size_t cnt,
+      struct extent *spare)
+{
+  block_sector_t end = e->start + e->cnt;
+
+  ASSERT (sector >= e->start && sector + cnt <= end);
+  mark (sector, cnt, true);
+
+  list_remove (&e->bucket_elem);
+  if (sector > e->start && sector + cnt < end)
+    {
+      ASSERT (spare != NULL);
+      list_insert (list_next (&e->elem), &spare->elem);
+      extent_set (spare, sector + cnt, end - (sector + cnt));
+      extent_set (e, e->start, sector - e->start);
+    }
+  else
+    {
+      free (spare);
+      if (sector == e->start)
+        extent_set (e, sector + cnt, e->cnt - cnt);
+      else
+        extent_set (e, e->start, e->cnt - cnt);
+    }
+}
+
+/* Makes the extents usable, rebuilding them if they are stale.
+   Returns false if they are still stale. */
+static bool
+extents_ready (void)
+{
+  if (extents_stale)
+    extents_build ();
+  return !extents_stale;
+}
 
 /* Initializes the free map. */
 void
@@ -17,36 +216,178 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  dirty = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                       BLOCK_SECTOR_SIZE));
+  if (dirty == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  list_init (&extents);
+  extents_build ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+   the first into *SECTORP.  Chooses the smallest free run that
+   is large enough, so that large runs stay available for large
+   files.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  struct extent *e;
+  block_sector_t sector;
+
+  if (!extents_ready ())
+    {
+      sector = bitmap_scan (free_map, 0, cnt, false);
+      if (sector == BITMAP_ERROR)
+        return false;
+      mark (sector, cnt, true);
+      *sectorp = sector;
+      return true;
+    }
+
+  e = extent_best_fit (cnt);
+  if (e == NULL)
+    return false;
+  *sectorp = e->start;
+  take (e, e->start, cnt, NULL);
+  return true;
+}
+
+/* Allocates up to MAX consecutive sectors, starting at the first
+   free sector at or after HINT if there is one, and stores the
+   first into *SECTORP.  Files use this to place new sectors right
+   after their last one, so that they stay contiguous as they
+   grow.
+   Returns the number of sectors allocated, which may be fewer
+   than MAX, or 0 if the disk is full. */
+size_t
+free_map_allocate_run (block_sector_t hint, size_t max,
+                       block_sector_t *sectorp)
+{
+  struct extent *e, *spare = NULL;
+  block_sector_t sector;
+  size_t cnt;
+
+  ASSERT (max > 0);
+  if (!extents_ready ())
+    {
+      sector = bitmap_scan (free_map, hint < bitmap_size (free_map) ? hint : 0,
+                            1, false);
+      if (sector == BITMAP_ERROR)
+        sector = bitmap_scan (free_map, 0, 1, false);
+      if (sector == BITMAP_ERROR)
+        return 0;
+      mark (sector, 1, true);
+      *sectorp = sector;
+      return 1;
+    }
+
+  e = extent_after (hint);
+  if (e == NULL)
+    return 0;
+
+  /* Start at HINT if it is free, unless that needs a new extent
+     and there is no memory for one. */
+  sector = e->start;
+  if (hint > e->start && hint < e->start + e->cnt)
+    {
+      spare = malloc (sizeof *spare);
+      if (spare != NULL)
+        sector = hint;
+    }
+  cnt = e->start + e->cnt - sector;
+  if (cnt > max)
+    cnt = max;
+  else if (spare != NULL)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      /* Taking the rest of E does not split it. */
+      free (spare);
+      spare = NULL;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
-  return sector != BITMAP_ERROR;
+
+  take (e, sector, cnt, spare);
+  *sectorp = sector;
+  return cnt;
 }
 
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  struct list_elem *elem;
+  struct extent *prev = NULL, *next = NULL;
+
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  mark (sector, cnt, false);
+  if (extents_stale)
+    return;
+
+  /* Find the extents on either side and merge with them. */
+  for (elem = list_begin (&extents); elem != list_end (&extents);
+       elem = list_next (elem))
+    {
+      next = list_entry (elem, struct extent, elem);
+      if (next->start > sector)
+        break;
+      prev = next;
+      next = NULL;
+    }
+  if (prev != NULL && prev->start + prev->cnt != sector)
+    prev = NULL;
+  if (next != NULL && next->start != sector + cnt)
+    next = NULL;
+
+  if (prev != NULL && next != NULL)
+    {
+      list_remove (&prev->bucket_elem);
+      list_remove (&next->bucket_elem);
+      extent_set (prev, prev->start, prev->cnt + cnt + next->cnt);
+      extent_set (next, next->start, 0);
+    }
+  else if (prev != NULL)
+    {
+      list_remove (&prev->bucket_elem);
+      extent_set (prev, prev->start, prev->cnt + cnt);
+    }
+  else if (next != NULL)
+    {
+      list_remove (&next->bucket_elem);
+      extent_set (next, sector, next->cnt + cnt);
+    }
+  else
+    {
+      struct extent *e = malloc (sizeof *e);
+      if (e == NULL)
+        {
+          extents_clear ();
+          extents_stale = true;
+          return;
+        }
+      list_insert (elem, &e->elem);
+      extent_set (e, sector, cnt);
+    }
+}
+
+/* Writes the sectors of the free map file that have changed
+   since the last flush into the buffer cache, which writes them
+   to disk in turn.  Callers flush once per file system operation,
+   so the allocations and releases it makes reach the cache as a
+   single write per free map sector touched. */
+void
+free_map_flush (void)
+{
+  size_t idx = 0;
+
+  if (free_map_file == NULL)
+    return;
+  while ((idx = bitmap_scan_and_flip (dirty, idx, 1, true)) != BITMAP_ERROR)
+    {
+      if (!bitmap_write_part (free_map, free_map_file,
+                              idx * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE))
+        PANIC ("can't write free map");
+      idx++;
+    }
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -58,13 +399,19 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  bitmap_set_all (dirty, false);
+  extents_build ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) 
 {
-  file_close (free_map_file);
+  struct file *file = free_map_file;
+
+  free_map_flush ();
+  free_map_file = NULL;
+  file_close (file);
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -82,4 +429,5 @@ free_map_create (void)
     PANIC ("can't open free map");
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty, false);
 }
@@ -3,6 +3,7 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
@@ -10,14 +11,29 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Sector pointers in a direct inode, in an index block, and
+   the most sectors a file can have: about 8 MB. */
+#define INODE_DIRECT 124
+#define INODE_PTRS (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+#define INODE_MAX_SECTORS \
+        (INODE_DIRECT + INODE_PTRS + INODE_PTRS * INODE_PTRS)
+
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   Data sectors are found through DIRECT for the first
+   INODE_DIRECT sectors of the file, then through the index block
+   INDIRECT, then through the index blocks listed in the index
+   block DOUBLE_INDIRECT.  A pointer of 0 means no sector is
+   allocated: sector 0 always holds the free map's inode.  Every
+   sector below LENGTH is allocated. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    block_sector_t direct[INODE_DIRECT]; /* First data sectors. */
+    block_sector_t indirect;            /* Index block. */
+    block_sector_t double_indirect;     /* Index block of index blocks. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,6 +44,21 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* Sectors set aside for a file to grow into, allocated in the
+   free map but not yet part of the file.  Taking a run of sectors
+   at a time keeps a file contiguous even while other files grow
+   alongside it.  An open file gives back what it has not used
+   when it is closed, so a crash leaks them until the disk is
+   reformatted. */
+struct reserve
+  {
+    block_sector_t start;               /* First reserved sector. */
+    size_t cnt;                         /* Number of reserved sectors. */
+  };
+
+/* Number of sectors to reserve at a time for a growing file. */
+#define RESERVE_SECTORS 16
+
 /* In-memory inode. */
 struct inode 
   {
@@ -36,9 +67,41 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct reserve reserve;             /* Sectors set aside for growth. */
     struct inode_disk data;             /* Inode content. */
   };
 
+/* Returns entry I of index block BLOCK. */
+static block_sector_t
+index_get (block_sector_t block, size_t i)
+{
+  block_sector_t sector;
+  cache_read_at (block, &sector, i * sizeof sector, sizeof sector);
+  return sector;
+}
+
+/* Returns the sector that holds sector IDX of the file that
+   DISK_INODE describes, or 0 if none is allocated. */
+static block_sector_t
+index_to_sector (const struct inode_disk *disk_inode, size_t idx)
+{
+  block_sector_t block;
+
+  if (idx < INODE_DIRECT)
+    return disk_inode->direct[idx];
+  idx -= INODE_DIRECT;
+
+  if (idx < INODE_PTRS)
+    return (disk_inode->indirect != 0
+            ? index_get (disk_inode->indirect, idx) : 0);
+  idx -= INODE_PTRS;
+
+  if (disk_inode->double_indirect == 0)
+    return 0;
+  block = index_get (disk_inode->double_indirect, idx / INODE_PTRS);
+  return block != 0 ? index_get (block, idx % INODE_PTRS) : 0;
+}
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -48,11 +111,187 @@ byte_to_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+    return index_to_sector (&inode->data, pos / BLOCK_SECTOR_SIZE);
   else
     return -1;
 }
 
+/* Returns the number of index blocks needed by a file of
+   SECTORS sectors. */
+static size_t
+index_blocks (size_t sectors)
+{
+  if (sectors <= INODE_DIRECT)
+    return 0;
+  sectors -= INODE_DIRECT;
+  if (sectors <= INODE_PTRS)
+    return 1;
+  sectors -= INODE_PTRS;
+  return 2 + DIV_ROUND_UP (sectors, INODE_PTRS);
+}
+
+/* Takes the next sector from reservation R and stores it into
+   *SECTORP.  If R is empty, first reserves a new run of sectors
+   starting as close after HINT as possible.  Returns false if
+   the disk is full. */
+static bool
+reserve_take (struct reserve *r, block_sector_t hint, block_sector_t *sectorp)
+{
+  if (r->cnt == 0)
+    {
+      r->cnt = free_map_allocate_run (hint, RESERVE_SECTORS, &r->start);
+      if (r->cnt == 0)
+        return false;
+    }
+  *sectorp = r->start++;
+  r->cnt--;
+  return true;
+}
+
+/* Returns the sectors left in reservation R to the free map. */
+static void
+reserve_release (struct reserve *r)
+{
+  if (r->cnt > 0)
+    free_map_release (r->start, r->cnt);
+  r->cnt = 0;
+}
+
+/* Makes *SECTORP point to a zeroed sector, taken from R, unless
+   it already points to one.  Returns false if the disk is
+   full. */
+static bool
+ensure_sector (block_sector_t *sectorp, struct reserve *r,
+               block_sector_t hint)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (*sectorp != 0)
+    return true;
+  if (!reserve_take (r, hint, sectorp))
+    return false;
+  cache_write (*sectorp, zeros);
+  return true;
+}
+
+/* Like ensure_sector(), for entry I of index block BLOCK, whose
+   value is stored in *SECTORP. */
+static bool
+ensure_index (block_sector_t block, size_t i, struct reserve *r,
+              block_sector_t hint, block_sector_t *sectorp)
+{
+  *sectorp = index_get (block, i);
+  if (*sectorp != 0)
+    return true;
+  if (!ensure_sector (sectorp, r, hint))
+    return false;
+  cache_write_at (block, sectorp, i * sizeof *sectorp, sizeof *sectorp);
+  return true;
+}
+
+/* Allocates sector IDX of the file that DISK_INODE describes,
+   with any index blocks it needs, from R, and stores it in
+   *SECTORP.  HINT is where R should start if it must be
+   refilled.  Returns false if the disk is full. */
+static bool
+allocate_index (struct inode_disk *disk_inode, size_t idx,
+                struct reserve *r, block_sector_t hint,
+                block_sector_t *sectorp)
+{
+  block_sector_t block;
+
+  if (idx < INODE_DIRECT)
+    {
+      if (!ensure_sector (&disk_inode->direct[idx], r, hint))
+        return false;
+      *sectorp = disk_inode->direct[idx];
+      return true;
+    }
+  idx -= INODE_DIRECT;
+
+  if (idx < INODE_PTRS)
+    return (ensure_sector (&disk_inode->indirect, r, hint)
+            && ensure_index (disk_inode->indirect, idx, r, hint, sectorp));
+  idx -= INODE_PTRS;
+
+  return (ensure_sector (&disk_inode->double_indirect, r, hint)
+          && ensure_index (disk_inode->double_indirect, idx / INODE_PTRS,
+                           r, hint, &block)
+          && ensure_index (block, idx % INODE_PTRS, r, hint, sectorp));
+}
+
+/* Grows the file that DISK_INODE, stored in sector SECTOR,
+   describes to LENGTH bytes, allocating zeroed sectors for it
+   from R.  When R runs out it is refilled from right after the
+   file's last sector if that is free, to keep the file
+   contiguous.  Returns true if successful.  If the disk fills up
+   or LENGTH exceeds the maximum file size, grows the file as far
+   as possible and returns false.  Does not write DISK_INODE
+   itself back. */
+static bool
+extend (struct inode_disk *disk_inode, struct reserve *r,
+        block_sector_t sector, off_t length)
+{
+  size_t have = bytes_to_sectors (disk_inode->length);
+  size_t need = bytes_to_sectors (length);
+  block_sector_t last = have > 0 ? index_to_sector (disk_inode, have - 1)
+                                 : sector;
+  bool success = true;
+
+  if (need > INODE_MAX_SECTORS)
+    {
+      need = INODE_MAX_SECTORS;
+      length = need * BLOCK_SECTOR_SIZE;
+      success = false;
+    }
+  for (; have < need; have++)
+    if (!allocate_index (disk_inode, have, r, last + 1, &last))
+      {
+        length = have * BLOCK_SECTOR_SIZE;
+        success = false;
+        break;
+      }
+  if (length > disk_inode->length)
+    disk_inode->length = length;
+  return success;
+}
+
+/* Releases index block BLOCK and the sectors it lists, which are
+   themselves index blocks if LEVEL is greater than 1. */
+static void
+release_index (block_sector_t block, int level)
+{
+  size_t i;
+
+  for (i = 0; i < INODE_PTRS; i++)
+    {
+      block_sector_t sector = index_get (block, i);
+      if (sector == 0)
+        continue;
+      if (level > 1)
+        release_index (sector, level - 1);
+      else
+        free_map_release (sector, 1);
+    }
+  free_map_release (block, 1);
+}
+
+/* Releases every sector of the file that DISK_INODE describes,
+   but not the inode's own sector. */
+static void
+release_sectors (struct inode_disk *disk_inode)
+{
+  size_t i;
+
+  for (i = 0; i < INODE_DIRECT; i++)
+    if (disk_inode->direct[i] != 0)
+      free_map_release (disk_inode->direct[i], 1);
+  if (disk_inode->indirect != 0)
+    release_index (disk_inode->indirect, 1);
+  if (disk_inode->double_indirect != 0)
+    release_index (disk_inode->double_indirect, 2);
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
@@ -73,6 +312,8 @@ bool
 inode_create (block_sector_t sector, off_t length)
 {
   struct inode_disk *disk_inode = NULL;
+  struct reserve reserve = {0, 0};
+  size_t sectors = bytes_to_sectors (length);
   bool success = false;
 
   ASSERT (length >= 0);
@@ -84,22 +325,25 @@ inode_create (block_sector_t sector, off_t length)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
+
+      /* The file's size is known, so put it in the smallest free
+         run that holds it, if there is one. */
+      if (sectors > 0)
+        {
+          size_t cnt = sectors + index_blocks (sectors);
+          if (free_map_allocate (cnt, &reserve.start))
+            reserve.cnt = cnt;
+        }
+
+      if (extend (disk_inode, &reserve, sector, length))
         {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
+          cache_write (sector, disk_inode);
           success = true; 
-        } 
+        }
+      else
+        release_sectors (disk_inode);
+      reserve_release (&reserve);
       free (disk_inode);
     }
   return success;
@@ -137,7 +381,8 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->reserve.cnt = 0;
+  cache_read (inode->sector, &inode->data);
   return inode;
 }
 
@@ -172,14 +417,15 @@ inode_close (struct inode *inode)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      reserve_release (&inode->reserve);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          release_sectors (&inode->data);
         }
+      free_map_flush ();
 
       free (inode); 
     }
@@ -202,7 +448,6 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0) 
     {
@@ -220,51 +465,73 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      cache_read_at (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
 
+/* Starts reading the sectors that hold bytes OFFSET through
+   OFFSET + SIZE of INODE into the cache in the background, as far
+   as INODE extends. */
+void
+inode_read_ahead (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  for (offset = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE); offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    cache_prefetch (byte_to_sector (inode, offset));
+}
+
+/* Returns true if every sector that holds bytes OFFSET through
+   OFFSET + SIZE of INODE, as far as INODE extends, is in the
+   cache, so that reading them now would not wait for the disk. */
+bool
+inode_cached (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  for (offset = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE); offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    if (!cache_contains (byte_to_sector (inode, offset)))
+      return false;
+  return true;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
-   Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   A write past end of file extends the inode, filling any gap
+   with zeros.  Returns the number of bytes actually written,
+   which may be less than SIZE if the disk is full, the file
+   reaches the maximum size, or an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  if (offset + size > inode->data.length)
+    {
+      off_t old_length = inode->data.length;
+      extend (&inode->data, &inode->reserve, inode->sector, offset + size);
+      if (inode->data.length != old_length)
+        cache_write (inode->sector, &inode->data);
+      free_map_flush ();
+    }
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -281,38 +548,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* The cache reads in the rest of a partly written sector. */
+      cache_write_at (sector_idx, buffer + bytes_written, sector_ofs,
+                      chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
   return bytes_written;
 }
@@ -343,3 +587,23 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Returns the number of extents, runs of consecutive sectors,
+   that INODE's data occupies. */
+size_t
+inode_extent_cnt (const struct inode *inode)
+{
+  size_t sectors = bytes_to_sectors (inode->data.length);
+  block_sector_t prev = 0;
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = 0; i < sectors; i++)
+    {
+      block_sector_t sector = index_to_sector (&inode->data, i);
+      if (i == 0 || sector != prev + 1)
+        cnt++;
+      prev = sector;
+    }
+  return cnt;
+}
@@ -28,7 +28,30 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_MSYNC,                  /* Write a memory mapping back. */
+    SYS_MADVISE,                /* Advise on use of a memory range. */
+    SYS_MMAP2,                  /* Map a file into memory, with flags. */
+    SYS_OOM_ADJUST,             /* Bias the OOM killer for this process. */
+    SYS_RSS_LIMIT               /* Limit this process's resident set. */
   };
 
+/* Flags for mmap2(). */
+#define MAP_POPULATE 0x1        /* Read the whole mapping in now. */
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* Default fault-around. */
+#define MADV_RANDOM 1           /* No fault-around. */
+#define MADV_SEQUENTIAL 2       /* Large fault-around, drop pages behind. */
+#define MADV_WILLNEED 3         /* Read the range in now. */
+#define MADV_DONTNEED 4         /* Drop the range's pages. */
+
+/* Range of oom_adjust() values.  OOM_ADJ_MIN exempts a process
+   from the OOM killer; OOM_ADJ_MAX makes it the first choice. */
+#define OOM_ADJ_MIN (-1000)
+#define OOM_ADJ_MAX 1000
+
 #endif /* lib/syscall-nr.h */
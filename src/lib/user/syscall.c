@@ -1,31 +1,47 @@
 #include <syscall.h>
+#include <stdint.h>
 #include "../syscall-nr.h"
 
+/* True if system calls enter the kernel with SYSENTER rather than
+   "int $0x30".  Set by syscall_detect(). */
+bool syscall_sysenter;
+
+/* Enters the kernel for the system call whose number and ARGS
+   argument words have just been pushed, then pops them.  SYSENTER
+   takes the stack pointer in ECX and the address to return to in
+   EDX; the kernel returns there with SYSEXIT. */
+#define SYSCALL_ENTER(ARGS)                                     \
+        "cmpb $0, syscall_sysenter; je 1f; "                    \
+        "movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "        \
+        "1: int $0x30; "                                        \
+        "2: addl $" #ARGS "*4+4, %%esp"
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_ENTER (0)              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; "                 \
+             SYSCALL_ENTER (1)                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0)                              \
+               : "ecx", "edx", "cc", "memory");                 \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +51,12 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_ENTER (2)              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -51,16 +67,36 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_ENTER (3)              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1),                             \
                  [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
+/* Uses SYSENTER for system calls if the CPU implements it, as
+   reported by CPUID, in which case the kernel has set it up.
+   Called by _start() before main(). */
+void
+syscall_detect (void)
+{
+  uint32_t before, after;
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  /* CPUID exists if the ID bit in EFLAGS can be toggled. */
+  asm volatile ("pushfl; popl %0; movl %0, %1; xorl $0x200000, %1; "
+                "pushl %1; popfl; pushfl; popl %1; pushl %0; popfl"
+                : "=&r" (before), "=&r" (after));
+  if (((before ^ after) & 0x200000) == 0)
+    return;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  syscall_sysenter = (edx & 0x800) != 0;      /* CPUID_SEP. */
+}
+
 void
 halt (void) 
 {
@@ -182,3 +218,39 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+void
+msync (mapid_t mapid)
+{
+  syscall1 (SYS_MSYNC, mapid);
+}
+
+int
+madvise (void *addr, size_t length, int advice)
+{
+  return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+mapid_t
+mmap2 (int fd, void *addr, int flags)
+{
+  return syscall3 (SYS_MMAP2, fd, addr, flags);
+}
+
+void
+oom_adjust (int adj)
+{
+  syscall1 (SYS_OOM_ADJUST, adj);
+}
+
+int
+rss_limit (int pages)
+{
+  return syscall1 (SYS_RSS_LIMIT, pages);
+}
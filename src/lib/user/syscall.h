@@ -2,7 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,18 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+pid_t fork (void);
+void msync (mapid_t);
+int madvise (void *addr, size_t length, int advice);
+mapid_t mmap2 (int fd, void *addr, int flags);
+void oom_adjust (int adj);
+int rss_limit (int pages);
+
+/* System call entry.  _start() calls syscall_detect(), which sets
+   syscall_sysenter if the CPU supports the SYSENTER fast path; a
+   program may clear it to enter through "int $0x30" instead. */
+extern bool syscall_sysenter;
+void syscall_detect (void);
+
 #endif /* lib/user/syscall.h */
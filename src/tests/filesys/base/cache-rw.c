@@ -0,0 +1,54 @@
+/* Writes a file larger than the buffer cache in chunks that do not
+   line up with sectors, then reads it back in chunks of another
+   size, so that partly written sectors are evicted dirty and read
+   back in. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (48 * 1024)
+#define WRITE_CHUNK 317
+#define READ_CHUNK 1000
+
+static char buf[READ_CHUNK];
+
+/* Returns the byte at offset OFS of the file. */
+static char
+byte_at (int ofs)
+{
+  return ofs * 7 + ofs / 512;
+}
+
+void
+test_main (void)
+{
+  int handle, ofs, i;
+
+  CHECK (create ("cached", FILE_SIZE), "create \"cached\"");
+  CHECK ((handle = open ("cached")) > 1, "open \"cached\"");
+
+  msg ("write in %d-byte chunks", WRITE_CHUNK);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += WRITE_CHUNK)
+    {
+      int size = FILE_SIZE - ofs < WRITE_CHUNK ? FILE_SIZE - ofs : WRITE_CHUNK;
+      for (i = 0; i < size; i++)
+        buf[i] = byte_at (ofs + i);
+      if (write (handle, buf, size) != size)
+        fail ("write of %d bytes at offset %d failed", size, ofs);
+    }
+
+  msg ("read back in %d-byte chunks", READ_CHUNK);
+  seek (handle, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += READ_CHUNK)
+    {
+      int size = FILE_SIZE - ofs < READ_CHUNK ? FILE_SIZE - ofs : READ_CHUNK;
+      if (read (handle, buf, size) != size)
+        fail ("read of %d bytes at offset %d failed", size, ofs);
+      for (i = 0; i < size; i++)
+        if (buf[i] != byte_at (ofs + i))
+          fail ("byte %d is %02hhx, not %02hhx",
+                ofs + i, buf[i], byte_at (ofs + i));
+    }
+  close (handle);
+}
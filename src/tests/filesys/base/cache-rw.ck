@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-rw) begin
+(cache-rw) create "cached"
+(cache-rw) open "cached"
+(cache-rw) write in 317-byte chunks
+(cache-rw) read back in 1000-byte chunks
+(cache-rw) end
+EOF
+pass;
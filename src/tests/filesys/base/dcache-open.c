@@ -0,0 +1,38 @@
+/* Opens the same names over and over, present and missing, so
+   that the kernel answers from its directory entry cache, and
+   checks that creating and removing a name updates what the
+   cache answers. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define REPEAT 100
+
+void
+test_main (void)
+{
+  int i, fd;
+
+  CHECK (create ("present", 0), "create \"present\"");
+  msg ("open \"present\" and \"absent\" %d times", REPEAT);
+  for (i = 0; i < REPEAT; i++)
+    {
+      if ((fd = open ("present")) < 2)
+        fail ("open \"present\" failed");
+      close (fd);
+      if (open ("absent") != -1)
+        fail ("open \"absent\" succeeded");
+    }
+
+  CHECK (create ("absent", 0), "create \"absent\"");
+  CHECK ((fd = open ("absent")) > 1, "open \"absent\"");
+  close (fd);
+  CHECK (!create ("absent", 0), "create \"absent\" again (must fail)");
+
+  CHECK (remove ("present"), "remove \"present\"");
+  CHECK (open ("present") == -1, "open \"present\" (must fail)");
+  CHECK (create ("present", 0), "create \"present\" again");
+  CHECK ((fd = open ("present")) > 1, "open \"present\"");
+  close (fd);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dcache-open) begin
+(dcache-open) create "present"
+(dcache-open) open "present" and "absent" 100 times
+(dcache-open) create "absent"
+(dcache-open) open "absent"
+(dcache-open) create "absent" again (must fail)
+(dcache-open) remove "present"
+(dcache-open) open "present" (must fail)
+(dcache-open) create "present" again
+(dcache-open) open "present"
+(dcache-open) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Creates, looks up, and deletes 10,000 names in the root
+   directory, timing each phase, so that a directory that grows
+   far past a few sectors stays fast to search.  Prints cycle
+   counts, which the checker does not compare; it checks from the
+   kernel's statistics that the removed files are gone. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NAMES 10000
+
+/* Stores the name of file I in NAME. */
+static void
+make_name (char name[16], int i)
+{
+  snprintf (name, 16, "n%d", i);
+}
+
+void
+test_main (void)
+{
+  char name[16];
+  uint64_t start;
+  int i, fd;
+
+  msg ("create %d files", NAMES);
+  start = rdtsc ();
+  for (i = 0; i < NAMES; i++)
+    {
+      make_name (name, i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("create: %llu cycles per file", (rdtsc () - start) / NAMES);
+
+  msg ("open %d files", NAMES);
+  start = rdtsc ();
+  for (i = NAMES - 1; i >= 0; i--)
+    {
+      make_name (name, i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("open: %llu cycles per file", (rdtsc () - start) / NAMES);
+
+  msg ("remove %d files", NAMES);
+  start = rdtsc ();
+  for (i = 0; i < NAMES; i++)
+    {
+      make_name (name, i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  msg ("remove: %llu cycles per file", (rdtsc () - start) / NAMES);
+
+  CHECK (open ("n0") == -1, "open \"n0\" after removal");
+}
@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(dir-scale) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(dir-scale) end', @output);
+foreach my $op ('create', 'open', 'remove') {
+    fail "missing $op message\n"
+      if !grep ($_ eq "(dir-scale) $op 10000 files", @output);
+    fail "missing $op timing\n"
+      if !grep (/^\(dir-scale\) $op: \d+ cycles per file$/, @output);
+}
+fail "removed file still opens\n"
+  if !grep ($_ eq '(dir-scale) open "n0" after removal', @output);
+
+# Only the test program itself is left in the root directory.
+my ($fs) = grep (/^File system: /, @stats);
+fail "missing file system statistics\n" if !defined $fs;
+my ($files) = $fs =~ /^File system: (\d+) files in \d+ extents$/
+  or fail "malformed file system statistics: $fs\n";
+fail "$files files left after removing all 10000\n" if $files > 1;
+pass;
@@ -0,0 +1,67 @@
+/* Grows an empty file by appending to it until it needs
+   double-indirect index blocks, then writes past its end, and
+   checks that the data reads back and the gap reads as zeros. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK 1000
+#define APPENDS 200                     /* About 195 kB. */
+#define GAP 5000
+
+static char buf[CHUNK];
+
+/* Returns the byte at offset OFS of the file. */
+static char
+byte_at (int ofs)
+{
+  return ofs % 251;
+}
+
+void
+test_main (void)
+{
+  int handle, ofs, size, i;
+
+  CHECK (create ("grown", 0), "create empty \"grown\"");
+  CHECK ((handle = open ("grown")) > 1, "open \"grown\"");
+
+  msg ("append %d chunks", APPENDS);
+  for (ofs = 0; ofs < APPENDS * CHUNK; ofs += CHUNK)
+    {
+      for (i = 0; i < CHUNK; i++)
+        buf[i] = byte_at (ofs + i);
+      if (write (handle, buf, CHUNK) != CHUNK)
+        fail ("append at offset %d failed", ofs);
+      if (filesize (handle) != ofs + CHUNK)
+        fail ("file size is %d after append at offset %d",
+              filesize (handle), ofs);
+    }
+
+  msg ("write past end of file");
+  seek (handle, APPENDS * CHUNK + GAP);
+  CHECK (write (handle, buf, CHUNK) == CHUNK, "write after gap");
+  size = APPENDS * CHUNK + GAP + CHUNK;
+  if (filesize (handle) != size)
+    fail ("file size is %d, not %d", filesize (handle), size);
+
+  msg ("read back");
+  seek (handle, 0);
+  for (ofs = 0; ofs < APPENDS * CHUNK; ofs += CHUNK)
+    {
+      if (read (handle, buf, CHUNK) != CHUNK)
+        fail ("read at offset %d failed", ofs);
+      for (i = 0; i < CHUNK; i++)
+        if (buf[i] != byte_at (ofs + i))
+          fail ("byte %d is %02hhx, not %02hhx",
+                ofs + i, buf[i], byte_at (ofs + i));
+    }
+  for (i = 0; i < GAP; i++)
+    {
+      char c;
+      if (read (handle, &c, 1) != 1 || c != 0)
+        fail ("gap byte %d is not zero", i);
+    }
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(file-grow) begin
+(file-grow) create empty "grown"
+(file-grow) open "grown"
+(file-grow) append 200 chunks
+(file-grow) write past end of file
+(file-grow) write after gap
+(file-grow) read back
+(file-grow) end
+EOF
+pass;
@@ -0,0 +1,111 @@
+/* Ages the file system by creating and deleting files of random
+   sizes at random, then writes a large file while another file
+   grows alongside it and times reading it back sequentially.
+   The kernel reports how many extents the surviving files
+   occupy at shutdown, which the checker compares with what
+   allocating one sector at a time would give.  Prints cycle
+   counts, which the checker does not compare. */
+
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SLOTS 24
+#define ROUNDS 200
+#define CHUNK 512
+#define MAX_CHUNKS 32
+#define BIG_SIZE (64 * 1024)
+
+static char buf[CHUNK];
+static bool present[SLOTS];
+
+/* Appends CHUNK bytes derived from OFS to HANDLE. */
+static void
+append (int handle, const char *name, int ofs)
+{
+  int i;
+
+  for (i = 0; i < CHUNK; i++)
+    buf[i] = (ofs + i) ^ ((ofs + i) >> 9);
+  if (write (handle, buf, CHUNK) != CHUNK)
+    fail ("write to \"%s\" at offset %d failed", name, ofs);
+}
+
+/* Creates the file for SLOT and grows it a chunk at a time. */
+static void
+create_slot (int slot)
+{
+  char name[16];
+  int handle, chunks, i;
+
+  snprintf (name, sizeof name, "age%d", slot);
+  if (!create (name, 0))
+    fail ("create \"%s\" failed", name);
+  if ((handle = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  chunks = random_ulong () % MAX_CHUNKS + 1;
+  for (i = 0; i < chunks; i++)
+    append (handle, name, i * CHUNK);
+  close (handle);
+}
+
+/* Removes the file for SLOT. */
+static void
+remove_slot (int slot)
+{
+  char name[16];
+
+  snprintf (name, sizeof name, "age%d", slot);
+  if (!remove (name))
+    fail ("remove \"%s\" failed", name);
+}
+
+void
+test_main (void)
+{
+  int big, neighbor, ofs, i;
+  uint64_t start, cycles;
+
+  random_init (0);
+  msg ("age file system");
+  for (i = 0; i < ROUNDS; i++)
+    {
+      int slot = random_ulong () % SLOTS;
+      if (present[slot])
+        remove_slot (slot);
+      else
+        create_slot (slot);
+      present[slot] = !present[slot];
+    }
+
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK (create ("neighbor", 0), "create \"neighbor\"");
+  CHECK ((big = open ("big")) > 1, "open \"big\"");
+  CHECK ((neighbor = open ("neighbor")) > 1, "open \"neighbor\"");
+  msg ("write \"big\" and \"neighbor\" together");
+  for (ofs = 0; ofs < BIG_SIZE; ofs += CHUNK)
+    {
+      append (big, "big", ofs);
+      append (neighbor, "neighbor", ofs);
+    }
+  close (neighbor);
+  close (big);
+
+  CHECK ((big = open ("big")) > 1, "reopen \"big\"");
+  msg ("read \"big\" sequentially");
+  start = rdtsc ();
+  for (ofs = 0; ofs < BIG_SIZE; ofs += CHUNK)
+    {
+      if (read (big, buf, CHUNK) != CHUNK)
+        fail ("read of \"big\" at offset %d failed", ofs);
+      for (i = 0; i < CHUNK; i++)
+        if (buf[i] != (char) ((ofs + i) ^ ((ofs + i) >> 9)))
+          fail ("byte %d of \"big\" is wrong", ofs + i);
+    }
+  cycles = rdtsc () - start;
+  close (big);
+  msg ("sequential read: %llu cycles per KB", cycles / (BIG_SIZE / 1024));
+}
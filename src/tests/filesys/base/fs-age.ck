@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(fs-age) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(fs-age) end', @output);
+fail "missing read of \"big\"\n"
+  if !grep ($_ eq '(fs-age) read "big" sequentially', @output);
+fail "missing read timing\n"
+  if !grep (/^\(fs-age\) sequential read: \d+ cycles per KB$/, @output);
+
+# "big" and "neighbor" grew in alternation, 128 sectors each.  Had
+# their sectors been allocated one at a time, they alone would
+# occupy 256 extents.
+my ($fs) = grep (/^File system: /, @stats);
+fail "missing file system statistics\n" if !defined $fs;
+my ($files, $extents) = $fs =~ /^File system: (\d+) files in (\d+) extents$/
+  or fail "malformed file system statistics: $fs\n";
+fail "$files files in $extents extents, expected fewer than 256\n"
+  if $extents >= 256;
+pass;
@@ -0,0 +1,64 @@
+/* Reads a file sequentially, so that the kernel reads ahead of
+   the reader, and then at scattered offsets, so that it stops,
+   checking the data both times. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024)
+#define CHUNK 512
+#define RANDOM_READS 64
+
+static char buf[4096];
+
+/* Returns the byte at offset OFS of the file. */
+static char
+byte_at (int ofs)
+{
+  return ofs ^ (ofs >> 9);
+}
+
+/* Reads SIZE bytes at OFS from HANDLE and checks them. */
+static void
+check_read (int handle, int ofs, int size)
+{
+  int i;
+
+  seek (handle, ofs);
+  if (read (handle, buf, size) != size)
+    fail ("read of %d bytes at offset %d failed", size, ofs);
+  for (i = 0; i < size; i++)
+    if (buf[i] != byte_at (ofs + i))
+      fail ("byte %d is %02hhx, not %02hhx",
+            ofs + i, buf[i], byte_at (ofs + i));
+}
+
+void
+test_main (void)
+{
+  int handle, ofs, i;
+
+  CHECK (create ("streamed", FILE_SIZE), "create \"streamed\"");
+  CHECK ((handle = open ("streamed")) > 1, "open \"streamed\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      for (i = 0; i < (int) sizeof buf; i++)
+        buf[i] = byte_at (ofs + i);
+      if (write (handle, buf, sizeof buf) != (int) sizeof buf)
+        fail ("write at offset %d failed", ofs);
+    }
+  close (handle);
+
+  CHECK ((handle = open ("streamed")) > 1, "reopen \"streamed\"");
+  msg ("read sequentially");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK)
+    check_read (handle, ofs, CHUNK);
+
+  msg ("read at random offsets");
+  random_init (0);
+  for (i = 0; i < RANDOM_READS; i++)
+    check_read (handle, random_ulong () % (FILE_SIZE - CHUNK), CHUNK);
+  close (handle);
+}
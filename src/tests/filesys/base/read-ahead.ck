@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(read-ahead) begin
+(read-ahead) create "streamed"
+(read-ahead) open "streamed"
+(read-ahead) reopen "streamed"
+(read-ahead) read sequentially
+(read-ahead) read at random offsets
+(read-ahead) end
+EOF
+pass;
@@ -194,3 +194,13 @@ compare_bytes (const void *read_data_, const void *expected_data_, size_t size,
   fail ("%zu bytes read starting at offset %zu in \"%s\" differ "
         "from expected", j - i, ofs + i, file_name);
 }
+
+/* Returns the processor's time-stamp counter, for benchmarks.
+   Counts vary from run to run, so checkers never compare them. */
+uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
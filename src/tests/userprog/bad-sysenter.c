@@ -0,0 +1,54 @@
+/* Sets the trap flag immediately before SYSENTER, so that the
+   single-step trap is taken on the kernel's first instruction.
+   The kernel must clear the flag and carry out the system call
+   rather than crash.  Then sets the nested task flag and waits
+   through SYSENTER for a child, so that the kernel blocks with
+   whatever flags the user left.  NT must not leak into the
+   threads that run meanwhile, whose IRET would then try a task
+   return. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "../syscall-nr.h"
+
+static const char message[] = "single-stepped sysenter\n";
+
+void
+test_main (void) 
+{
+  pid_t child;
+  int retval;
+
+  if (!syscall_sysenter)
+    {
+      msg ("sysenter not supported");
+      return;
+    }
+
+  asm volatile ("pushl %[size]; pushl %[buffer]; pushl $1; "
+                "pushl %[number]; "
+                "movl %%esp, %%ecx; movl $1f, %%edx; "
+                "pushfl; orl $0x100, (%%esp); popfl; "
+                "sysenter; "
+                "1: addl $16, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_WRITE),
+                  [buffer] "r" (message),
+                  [size] "i" (sizeof message - 1)
+                : "ecx", "edx", "cc", "memory");
+  msg ("write returned %d", retval);
+
+  child = exec ("child-simple");
+  asm volatile ("pushl %[child]; pushl %[number]; "
+                "movl %%esp, %%ecx; movl $1f, %%edx; "
+                "pushfl; orl $0x4000, (%%esp); popfl; "
+                "sysenter; "
+                "1: pushfl; andl $~0x4000, (%%esp); popfl; "
+                "addl $8, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_WAIT),
+                  [child] "r" (child)
+                : "ecx", "edx", "cc", "memory");
+  msg ("wait returned %d", retval);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(bad-sysenter) begin
+single-stepped sysenter
+(bad-sysenter) write returned 24
+(child-simple) run
+child-simple: exit(81)
+(bad-sysenter) wait returned 81
+(bad-sysenter) end
+bad-sysenter: exit(0)
+EOF
+(bad-sysenter) begin
+(bad-sysenter) sysenter not supported
+(bad-sysenter) end
+bad-sysenter: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(fork-bench) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(fork-bench) end', @output);
+foreach my $pages (16, 64, 256) {
+    fail "missing timing for $pages resident pages\n"
+      if !grep (/^\(fork-bench\) $pages resident pages: \d+ cycles per fork$/,
+		@output);
+}
+
+# A child sharing the 256 resident pages copy-on-write adds a
+# mapping of each of their frames.
+my ($rmap) = grep (/^Reverse map: /, @stats);
+fail "missing reverse map statistics\n" if !defined $rmap;
+my ($peak) = $rmap =~ /^Reverse map: \d+ extra mappings, peak (\d+);/
+  or fail "malformed reverse map statistics: $rmap\n";
+fail "peak of $peak extra mappings, expected at least 256: "
+  . "fork did not share the pages\n" if $peak < 256;
+pass;
@@ -0,0 +1,62 @@
+/* Forks a process with 1.5 MB of data, more than fits in memory
+   alongside a second copy, so that pages shared copy-on-write
+   get swapped out and back in.  Parent and child each encrypt
+   and then decrypt their copy with their own key, and check
+   that the original contents are back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (3 * 512 * 1024)
+
+static char buf[SIZE];
+
+static void
+crypt_twice (const char *key)
+{
+  struct arc4 arc4;
+
+  arc4_init (&arc4, key, strlen (key));
+  arc4_crypt (&arc4, buf, SIZE);
+  arc4_init (&arc4, key, strlen (key));
+  arc4_crypt (&arc4, buf, SIZE);
+}
+
+static void
+check_pattern (const char *who)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) (i % 251))
+      fail ("%s: byte %zu is wrong", who, i);
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      crypt_twice ("child");
+      check_pattern ("child");
+      exit (0x42);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork failed");
+
+  crypt_twice ("parent");
+  check_pattern ("parent");
+  msg ("parent's data intact");
+  CHECK (wait (pid) == 0x42, "wait for child");
+}
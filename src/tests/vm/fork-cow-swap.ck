@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-cow-swap) begin
+(fork-cow-swap) fork
+(fork-cow-swap) parent's data intact
+(fork-cow-swap) wait for child
+(fork-cow-swap) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Forks a process with 64 kB of initialized data and checks that
+   writes made after the fork, by either process, stay private to
+   the process that made them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+static void
+check_bytes (const char *who, size_t ofs, size_t size, char c)
+{
+  size_t i;
+
+  for (i = ofs; i < ofs + size; i++)
+    if (buf[i] != c)
+      fail ("%s: byte %zu is %#x, not %#x", who, i, buf[i], c);
+}
+
+void
+test_main (void)
+{
+  int local = 1;
+  pid_t pid;
+
+  memset (buf, 'a', SIZE);
+
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* The child sees the data as it was at the fork, whether or
+         not the parent has written to it yet. */
+      check_bytes ("child", 0, SIZE, 'a');
+      if (local != 1)
+        fail ("child: stack variable is %d, not 1", local);
+      memset (buf, 'c', SIZE);
+      local = 2;
+      check_bytes ("child", 0, SIZE, 'c');
+      exit (0x42);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork failed");
+
+  /* Modify half of the buffer before the child exits. */
+  memset (buf, 'p', SIZE / 2);
+  CHECK (wait (pid) == 0x42, "wait for child");
+
+  msg ("check parent's data");
+  check_bytes ("parent", 0, SIZE / 2, 'p');
+  check_bytes ("parent", SIZE / 2, SIZE / 2, 'a');
+  if (local != 1)
+    fail ("parent: stack variable is %d, not 1", local);
+}
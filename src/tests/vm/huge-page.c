@@ -0,0 +1,94 @@
+/* Touches two 4 MB aligned ranges of a large BSS array, which the
+   kernel backs with huge pages when run with -hugepages, then
+   splits the first by dropping some of its pages with
+   madvise(MADV_DONTNEED) and the second by forking, checking the
+   data after each.  The checker also checks that the kernel
+   reports the huge pages and their splits. */
+
+#include <round.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (4 * 1024 * 1024)
+#define HUGE_PAGES (HUGE_SIZE / PAGE_SIZE)
+#define DROP_FIRST 16
+#define DROP_CNT 16
+
+static char buf[3 * HUGE_SIZE];
+
+/* Returns the byte to store in page I of a region filled with
+   SEED. */
+static char
+page_byte (int seed, int i)
+{
+  return seed + i * 7;
+}
+
+/* Writes SEED's bytes to the first and last byte of each page of
+   REGION. */
+static void
+fill (char *region, int seed)
+{
+  int i;
+
+  for (i = 0; i < HUGE_PAGES; i++)
+    {
+      region[i * PAGE_SIZE] = page_byte (seed, i);
+      region[i * PAGE_SIZE + PAGE_SIZE - 1] = page_byte (seed, i);
+    }
+}
+
+/* Checks that page I of REGION holds SEED's bytes, or zeros if
+   it is one of the dropped pages and DROPPED is true. */
+static void
+check (const char *name, const char *region, int seed, bool dropped)
+{
+  int i;
+
+  for (i = 0; i < HUGE_PAGES; i++)
+    {
+      char expected = (dropped && i >= DROP_FIRST && i < DROP_FIRST + DROP_CNT
+                       ? 0 : page_byte (seed, i));
+      if (region[i * PAGE_SIZE] != expected
+          || region[i * PAGE_SIZE + PAGE_SIZE - 1] != expected)
+        fail ("%s: page %d is %02hhx, not %02hhx",
+              name, i, region[i * PAGE_SIZE], expected);
+    }
+}
+
+void
+test_main (void)
+{
+  char *a = (char *) ROUND_UP ((uintptr_t) buf, HUGE_SIZE);
+  char *b = a + HUGE_SIZE;
+  pid_t pid;
+
+  msg ("fill two 4 MB regions");
+  fill (a, 1);
+  fill (b, 2);
+  check ("first region", a, 1, false);
+  check ("second region", b, 2, false);
+
+  CHECK (madvise (a + DROP_FIRST * PAGE_SIZE, DROP_CNT * PAGE_SIZE,
+                  MADV_DONTNEED) == 0,
+         "drop %d pages of the first region", DROP_CNT);
+  check ("first region", a, 1, true);
+
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      check ("child's second region", b, 2, false);
+      fill (b, 3);
+      check ("child's second region", b, 3, false);
+      exit (77);
+    }
+  CHECK (pid != PID_ERROR, "fork succeeded");
+  CHECK (wait (pid) == 77, "wait for child");
+  check ("second region", b, 2, false);
+  check ("first region", a, 1, true);
+  msg ("data intact");
+}
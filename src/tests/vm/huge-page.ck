@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-page) begin
+(huge-page) fill two 4 MB regions
+(huge-page) drop 16 pages of the first region
+(huge-page) fork
+(huge-page) fork succeeded
+(huge-page) wait for child
+(huge-page) data intact
+(huge-page) end
+EOF
+
+# Both regions must have been huge pages, and both must have been
+# split: the first by madvise(), the second by fork().
+my (@output) = read_text_file ("$test.output");
+my ($stats) = grep (/^Huge pages: /, @output);
+fail "missing huge page statistics\n" if !defined $stats;
+my ($mapped, $split) = $stats =~ /^Huge pages: (\d+) mapped, .*; (\d+) split,/
+  or fail "malformed huge page statistics: $stats\n";
+fail "only $mapped huge pages mapped, expected at least 2\n" if $mapped < 2;
+fail "only $split huge pages split, expected at least 2\n" if $split < 2;
+pass;
@@ -0,0 +1,62 @@
+/* Measures a sequential scan of a 64-page mapped file under
+   demand faulting, MAP_POPULATE and MADV_SEQUENTIAL, checking the
+   data each time.  Prints cycle counts, which the checker does
+   not compare; it checks from the kernel's statistics that every
+   scan brought the whole file in. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 64
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[PAGE_SIZE];
+
+/* Maps "bench" with FLAGS and ADVICE, touches every page in
+   order and returns the cycles taken, including mmap(). */
+static uint64_t
+scan (const char *name, int flags, int advice)
+{
+  uint64_t start;
+  unsigned sum = 0;
+  mapid_t map;
+  int handle, i;
+
+  CHECK ((handle = open ("bench")) > 1, "open \"bench\" for %s", name);
+  start = rdtsc ();
+  map = mmap2 (handle, ACTUAL, flags);
+  if (map == MAP_FAILED)
+    fail ("mmap \"bench\" for %s", name);
+  if (advice != MADV_NORMAL && madvise (ACTUAL, PAGES * PAGE_SIZE, advice))
+    fail ("madvise for %s", name);
+  for (i = 0; i < PAGES; i++)
+    sum += ACTUAL[i * PAGE_SIZE];
+  start = rdtsc () - start;
+  if (sum != PAGES * 'b')
+    fail ("bad data in %s scan", name);
+  munmap (map);
+  close (handle);
+  return start;
+}
+
+void
+test_main (void)
+{
+  int handle, i;
+
+  CHECK (create ("bench", PAGES * PAGE_SIZE), "create \"bench\"");
+  CHECK ((handle = open ("bench")) > 1, "open \"bench\"");
+  memset (buf, 'b', sizeof buf);
+  for (i = 0; i < PAGES; i++)
+    if (write (handle, buf, sizeof buf) != sizeof buf)
+      fail ("write \"bench\"");
+  close (handle);
+
+  msg ("demand: %llu cycles", scan ("demand", 0, MADV_NORMAL));
+  msg ("populate: %llu cycles", scan ("populate", MAP_POPULATE, MADV_NORMAL));
+  msg ("sequential: %llu cycles", scan ("sequential", 0, MADV_SEQUENTIAL));
+}
@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(mmap-bench) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(mmap-bench) end', @output);
+foreach my $kind ('demand', 'populate', 'sequential') {
+    fail "missing timing for $kind scan\n"
+      if !grep (/^\(mmap-bench\) $kind: \d+ cycles$/, @output);
+}
+
+# Each of the three scans maps the 64-page file afresh, so its
+# pages are read in three times, by a fault, by fault-around or by
+# MAP_POPULATE.
+my ($fa) = grep (/^Fault-around: /, @stats);
+fail "missing fault-around statistics\n" if !defined $fa;
+my ($faults, $around)
+  = $fa =~ /^Fault-around: (\d+) file faults, (\d+) pages mapped around/
+  or fail "malformed fault-around statistics: $fa\n";
+fail "only " . ($faults + $around) . " file pages read in, "
+  . "expected at least 192\n" if $faults + $around < 192;
+pass;
@@ -0,0 +1,56 @@
+/* Checks MADV_DONTNEED: dropped anonymous pages read back as
+   zeros, and dropped pages of a mapped file are written back
+   first so that the data survives.  Also checks that bad
+   arguments are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+static char zeros[4096 * 4] __attribute__ ((aligned (4096)));
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+  char buf[1024];
+  size_t i;
+
+  /* Anonymous pages go back to their initial contents. */
+  memset (zeros, 0x5a, sizeof zeros);
+  CHECK (madvise (zeros, sizeof zeros, MADV_DONTNEED) == 0,
+         "madvise DONTNEED on bss");
+  for (i = 0; i < sizeof zeros; i++)
+    if (zeros[i] != 0)
+      fail ("byte %zu of dropped bss has value %02hhx (should be 0)",
+            i, zeros[i]);
+
+  /* File pages are written back before they are dropped. */
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, sample, strlen (sample));
+  CHECK (madvise (ACTUAL, 4096, MADV_DONTNEED) == 0,
+         "madvise DONTNEED on mapping");
+  if (memcmp (ACTUAL, sample, strlen (sample)))
+    fail ("mapping lost data across DONTNEED");
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+
+  /* Advice that only changes the fault policy. */
+  CHECK (madvise (ACTUAL, 4096, MADV_SEQUENTIAL) == 0,
+         "madvise SEQUENTIAL");
+  CHECK (madvise (ACTUAL, 4096, MADV_RANDOM) == 0, "madvise RANDOM");
+  CHECK (madvise ((char *) ACTUAL + 1, 4096, MADV_WILLNEED) == -1,
+         "madvise on misaligned address fails");
+  CHECK (madvise (ACTUAL, 4096, 99) == -1, "madvise with bad advice fails");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-madvise) begin
+(mmap-madvise) madvise DONTNEED on bss
+(mmap-madvise) create "sample.txt"
+(mmap-madvise) open "sample.txt"
+(mmap-madvise) mmap "sample.txt"
+(mmap-madvise) madvise DONTNEED on mapping
+(mmap-madvise) compare read data against written data
+(mmap-madvise) madvise SEQUENTIAL
+(mmap-madvise) madvise RANDOM
+(mmap-madvise) madvise on misaligned address fails
+(mmap-madvise) madvise with bad advice fails
+(mmap-madvise) end
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Writes to a file through a mapping, flushes it with msync, and
+   reads the data back with the read system call while the file is
+   still mapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, sample, strlen (sample));
+  msync (map);
+
+  /* Read back via read(), with the mapping still in place. */
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+  if (memcmp (ACTUAL, sample, strlen (sample)))
+    fail ("mapping changed by msync");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,31 @@
+/* Maps a file with MAP_POPULATE and checks that the data is
+   correct and followed by zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap2 (handle, actual, MAP_POPULATE)) != MAP_FAILED,
+         "mmap \"sample.txt\" with MAP_POPULATE");
+
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of populated mapping reported bad data");
+  for (i = strlen (sample); i < 4096; i++)
+    if (actual[i] != 0)
+      fail ("byte %zu of mmap'd region has value %02hhx (should be 0)",
+            i, actual[i]);
+
+  munmap (map);
+  close (handle);
+}
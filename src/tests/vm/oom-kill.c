@@ -0,0 +1,46 @@
+/* Forks a child that maps a file, writes to it through the
+   mapping, and then touches more memory than RAM and swap can
+   hold, with the parent exempt from the OOM killer.  Checks that
+   the child is killed instead of the kernel panicking or the
+   parent dying, and that the data the child wrote to the mapping
+   still reaches the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOG_SIZE (64 * 1024 * 1024)
+#define ACTUAL ((void *) 0x10000000)
+
+/* Not static, so that the stores to it are not optimized away. */
+char hog[HOG_SIZE];
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  CHECK (create ("sample.txt", sizeof sample), "create \"sample.txt\"");
+  oom_adjust (OOM_ADJ_MIN);
+  pid = fork ();
+  if (pid == 0)
+    {
+      size_t i;
+      int handle;
+
+      oom_adjust (0);
+      handle = open ("sample.txt");
+      if (handle < 2 || mmap (handle, ACTUAL) == MAP_FAILED)
+        exit (1);
+      memcpy (ACTUAL, sample, sizeof sample);
+      for (i = 0; i < HOG_SIZE; i += PAGE_SIZE)
+        hog[i] = 1;
+      exit (0);
+    }
+  CHECK (pid != PID_ERROR, "fork");
+  CHECK (wait (pid) == -1, "child killed by the OOM killer");
+  check_file ("sample.txt", sample, sizeof sample);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The OOM log's numbers depend on memory size, so only check that
+# the child was chosen, the parent carried on, and the file the
+# child had mapped got the data written to it.
+fail "missing OOM kill message\n"
+  if !grep (/^OOM: killing oom-kill \(tid \d+\): badness -?\d+/, @output);
+foreach my $line ('(oom-kill) begin', '(oom-kill) create "sample.txt"',
+		  '(oom-kill) fork',
+		  '(oom-kill) child killed by the OOM killer',
+		  '(oom-kill) open "sample.txt" for verification',
+		  '(oom-kill) verified contents of "sample.txt"',
+		  '(oom-kill) close "sample.txt"',
+		  '(oom-kill) end') {
+    fail "missing \"$line\"\n" if !grep ($_ eq $line, @output);
+}
+pass;
@@ -0,0 +1,37 @@
+/* Writes an initialized data page, forks, and writes the page
+   again in the parent, which takes a private copy.  The child
+   never writes the page, but the frame it still maps holds the
+   parent's first write.  After 2 MB of other pages push that
+   frame out, the child must still see the write, not the page's
+   contents in the executable. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+
+static char data[4096] = "initial";
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  strlcpy (data, "before fork", sizeof data);
+  pid = fork ();
+  if (pid == 0)
+    {
+      memset (buf, 0x5a, sizeof buf);
+      msg ("child sees \"%s\"", data);
+      exit (buf[SIZE - 1] == 0x5a ? 0 : 1);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork failed");
+  strlcpy (data, "after fork", sizeof data);
+  if (wait (pid) != 0)
+    fail ("child failed");
+  msg ("parent sees \"%s\"", data);
+}
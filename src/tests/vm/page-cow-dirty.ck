@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-cow-dirty) begin
+(page-cow-dirty) child sees "before fork"
+(page-cow-dirty) parent sees "after fork"
+(page-cow-dirty) end
+EOF
+pass;
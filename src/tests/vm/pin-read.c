@@ -0,0 +1,40 @@
+/* Reads a file into, and writes a file from, buffers whose pages
+   the process has never touched, so that the kernel has to fault
+   them in before it copies.  The read straddles a page boundary;
+   the write comes from the shared zero page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char buf[4 * PAGE];
+
+void
+test_main (void)
+{
+  char *p = buf + 2 * PAGE - 100;
+  size_t size = strlen (sample);
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, p, size) == (int) size, "read into untouched pages");
+  if (memcmp (p, sample, size))
+    fail ("read of sample.txt returned bad data");
+  close (handle);
+
+  CHECK (create ("zeros", PAGE), "create \"zeros\"");
+  CHECK ((handle = open ("zeros")) > 1, "open \"zeros\"");
+  CHECK (write (handle, buf + 3 * PAGE, PAGE) == PAGE,
+         "write from untouched page");
+  seek (handle, 0);
+  CHECK (read (handle, buf, PAGE) == PAGE, "read back");
+  for (i = 0; i < PAGE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu is %02hhx, not 0", i, buf[i]);
+  close (handle);
+}
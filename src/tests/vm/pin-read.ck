@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pin-read) begin
+(pin-read) open "sample.txt"
+(pin-read) read into untouched pages
+(pin-read) create "zeros"
+(pin-read) open "zeros"
+(pin-read) write from untouched page
+(pin-read) read back
+(pin-read) end
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Limits the process to 64 resident pages, then writes and reads
+   back 1 MB, which it can only do by replacing its own pages. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+#define LIMIT 64
+
+char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  rss_limit (LIMIT);
+  msg ("set limit");
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+  msg ("write 1 MB");
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) (i % 251))
+      fail ("byte %zu is %d, not %d", i, buf[i], (int) (i % 251));
+  msg ("read back");
+
+  CHECK (rss_limit (-1) <= LIMIT, "working set within limit");
+}
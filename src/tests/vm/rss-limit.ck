@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) set limit
+(rss-limit) write 1 MB
+(rss-limit) read back
+(rss-limit) working set within limit
+(rss-limit) end
+EOF
+pass;
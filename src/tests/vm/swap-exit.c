@@ -0,0 +1,36 @@
+/* Runs eight children in turn that each dirty 2 MB, more than
+   fits in memory, and exit with part of it in swap.  Together they
+   swap out more than the swap device holds, so the slots of each
+   child must be freed when it exits for the later ones to run. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define CHILDREN 8
+
+/* Not static, so that the stores to it are not optimized away. */
+char buf[SIZE];
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < CHILDREN; i++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          memset (buf, i + 1, sizeof buf);
+          exit (buf[SIZE - 1] == i + 1 ? 0 : 1);
+        }
+      if (pid == PID_ERROR)
+        fail ("fork failed");
+      if (wait (pid) != 0)
+        fail ("child %d failed", i);
+    }
+  msg ("all children ran");
+}
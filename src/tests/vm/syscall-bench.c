@@ -0,0 +1,51 @@
+/* Measures the latency of a system call that does almost nothing,
+   rss_limit() with a negative count, through "int $0x30" and
+   through SYSENTER, and checks that every call returns the same
+   result.  Prints cycle counts, which the checker does not
+   compare; it checks from the kernel's statistics that each path
+   was really taken. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALLS 4096
+
+/* Returns the average cycles per null system call made through
+   PATH.  Nothing faults meanwhile, so the working set, which is
+   what rss_limit() returns, must not change. */
+static uint64_t
+time_calls (const char *path)
+{
+  uint64_t start = rdtsc ();
+  int first = rss_limit (-1);
+  int i;
+
+  for (i = 1; i < CALLS; i++)
+    if (rss_limit (-1) != first)
+      break;
+  start = rdtsc () - start;
+  if (first < 0)
+    fail ("%s: rss_limit returned %d", path, first);
+  if (i < CALLS)
+    fail ("%s: rss_limit returned %d, then something else", path, first);
+  return start / CALLS;
+}
+
+void
+test_main (void)
+{
+  bool sysenter = syscall_sysenter;
+
+  syscall_sysenter = false;
+  msg ("int $0x30: %llu cycles per call", time_calls ("int $0x30"));
+
+  if (sysenter)
+    {
+      syscall_sysenter = true;
+      msg ("sysenter: %llu cycles per call", time_calls ("sysenter"));
+    }
+  else
+    msg ("sysenter: not supported");
+}
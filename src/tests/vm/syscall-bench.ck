@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(syscall-bench) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(syscall-bench) end', @output);
+fail "missing int \$0x30 timing\n"
+  if !grep (/^\(syscall-bench\) int \$0x30: \d+ cycles per call$/, @output);
+fail "missing sysenter timing\n"
+  if !grep (/^\(syscall-bench\) sysenter: (\d+ cycles per call|not supported)$/,
+            @output);
+
+# Each path the test timed must have carried all 4096 of its calls.
+my ($sc) = grep (/^System calls: /, @stats);
+fail "missing system call statistics\n" if !defined $sc;
+my ($int, $sysenter)
+  = $sc =~ /^System calls: (\d+) through int \$0x30, (\d+) through sysenter$/
+  or fail "malformed system call statistics: $sc\n";
+fail "only $int calls through int \$0x30, expected at least 4096\n"
+  if $int < 4096;
+if (grep ($_ eq '(syscall-bench) sysenter: not supported', @output)) {
+    fail "$sysenter calls through unsupported sysenter\n" if $sysenter != 0;
+} else {
+    fail "only $sysenter calls through sysenter, expected at least 4096\n"
+      if $sysenter < 4096;
+}
+pass;
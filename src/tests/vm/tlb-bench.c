@@ -0,0 +1,50 @@
+/* Measures the two paths that used to flush the whole TLB:
+   context switches, timed as fork() and wait() round trips, and
+   page eviction, timed as passes over a buffer too large to stay
+   resident.  Prints cycle counts, which the checker does not
+   compare; it checks from the kernel's TLB statistics that
+   eviction flushed single pages. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 512
+#define ROUNDS 16
+#define PASSES 2
+
+static char buf[PAGES * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  uint64_t start;
+  int round, pass, i;
+
+  start = rdtsc ();
+  for (round = 0; round < ROUNDS; round++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        exit (0);
+      if (pid == PID_ERROR)
+        fail ("fork failed");
+      if (wait (pid) != 0)
+        fail ("child exited with wrong status");
+    }
+  msg ("switch: %llu cycles per fork and wait", (rdtsc () - start) / ROUNDS);
+
+  start = rdtsc ();
+  for (pass = 0; pass < PASSES; pass++)
+    for (i = 0; i < PAGES; i++)
+      buf[i * PAGE_SIZE] = pass + i;
+  msg ("evict: %llu cycles per page touched",
+       (rdtsc () - start) / (PASSES * PAGES));
+
+  for (i = 0; i < PAGES; i++)
+    if (buf[i * PAGE_SIZE] != (char) (PASSES - 1 + i))
+      fail ("byte %d has wrong value", i * PAGE_SIZE);
+}
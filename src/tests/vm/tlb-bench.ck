@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@stats) = @output;
+@output = get_core_output ("run", @output);
+
+# Cycle counts vary from run to run, so only check the shape.
+fail "missing begin message\n" if !grep ($_ eq '(tlb-bench) begin', @output);
+fail "missing end message\n" if !grep ($_ eq '(tlb-bench) end', @output);
+fail "missing context switch timing\n"
+  if !grep (/^\(tlb-bench\) switch: \d+ cycles per fork and wait$/, @output);
+fail "missing eviction timing\n"
+  if !grep (/^\(tlb-bench\) evict: \d+ cycles per page touched$/, @output);
+
+# The buffer does not fit in memory, so its pages were evicted
+# while its page directory was active, each with one INVLPG.
+my ($tlb) = grep (/^TLB: /, @stats);
+fail "missing TLB statistics\n" if !defined $tlb;
+my ($invlpg) = $tlb =~ /^TLB: \d+ CR3 loads, \d+ skipped, (\d+) single-page/
+  or fail "malformed TLB statistics: $tlb\n";
+fail "no single-page TLB flushes\n" if $invlpg == 0;
+pass;
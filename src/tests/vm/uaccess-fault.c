@@ -0,0 +1,38 @@
+/* Passes system calls file names that run onto another page.  A
+   name whose tail is on a page the process has never touched must
+   work, because the kernel faults the page in as it copies; a name
+   that runs off the end of a mapping must kill the process, rather
+   than the kernel, when the copy faults. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[3 * PAGE];
+
+void
+test_main (void)
+{
+  static const char name[] = "sample.txt";
+  char *boundary = (char *) (((unsigned) buf + 2 * PAGE) & ~(PAGE - 1));
+  char *p = boundary - strlen (name);
+  int handle;
+
+  /* The terminating null is the first byte of an untouched page. */
+  memcpy (p, name, strlen (name));
+  CHECK ((handle = open (p)) > 1, "open name ending at untouched page");
+  close (handle);
+
+  /* Nothing is mapped after the last page of the file. */
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (handle, ACTUAL) != MAP_FAILED, "mmap \"sample.txt\"");
+  p = ACTUAL + PAGE - strlen (name);
+  memcpy (p, name, strlen (name));
+  msg ("open name running off the mapping");
+  open (p);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uaccess-fault) begin
+(uaccess-fault) open name ending at untouched page
+(uaccess-fault) open "sample.txt"
+(uaccess-fault) mmap "sample.txt"
+(uaccess-fault) open name running off the mapping
+uaccess-fault: exit(-1)
+EOF
+pass;
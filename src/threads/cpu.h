@@ -0,0 +1,65 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/flags.h"
+
+/* Feature bits returned in EDX by CPUID leaf 1.
+   See [IA32-v2a] "CPUID--CPU Identification". */
+#define CPUID_PSE 0x00000008    /* 4 MB pages. */
+#define CPUID_PGE 0x00002000    /* Global pages. */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT. */
+
+/* Model-specific registers for SYSENTER.
+   See [IA32-v3b] 4.8.7 "Fast System Calls in 32-Bit Mode". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* CR4 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Returns true if the CPU implements the CPUID instruction, that
+   is, if software can toggle the ID bit in EFLAGS. */
+static inline bool
+cpu_has_cpuid (void)
+{
+  uint32_t before, after;
+  asm volatile ("pushfl; popl %0; movl %0, %1; xorl %2, %1; "
+                "pushl %1; popfl; pushfl; popl %1; pushl %0; popfl"
+                : "=&r" (before), "=&r" (after) : "i" (FLAG_ID));
+  return ((before ^ after) & FLAG_ID) != 0;
+}
+
+/* Returns the feature flags that CPUID leaf 1 reports in EDX, or
+   0 if the CPU does not implement CPUID. */
+static inline uint32_t
+cpu_features (void)
+{
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+  if (!cpu_has_cpuid ())
+    return 0;
+  asm volatile ("cpuid"
+                : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Sets BITS in control register CR4. */
+static inline void
+cpu_set_cr4 (uint32_t bits)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4 | bits) : "memory");
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+cpu_wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+#endif /* threads/cpu.h */
@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -34,12 +35,16 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
 #ifdef VM
 #include "vm/frame.h"
 #include "vm/frame.c"
+#include "vm/spt.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
 #endif
 
 /* Page directory with kernel mappings only. */
@@ -61,6 +66,11 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef VM
+/* -zswap: Maximum number of kernel pages for compressed swap. */
+static size_t zswap_pool_pages = ZSWAP_DEFAULT_PAGES;
+#endif
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -108,6 +118,7 @@ main (void)
 #ifdef USERPROG
   tss_init ();
   gdt_init ();
+  sysenter_init ();
 #endif
 
   /* Initialize interrupt handlers. */
@@ -132,6 +143,13 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap. */
+  init_swap_table ();
+  zswap_init (zswap_pool_pages);
+  frame_start_kswapd ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -158,13 +176,24 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   The kernel mapping is the same in every page directory, so if
+   the CPU supports global pages its PTEs are marked global and
+   survive the CR3 reload on a context switch.  If it supports
+   4 MB pages, each whole 4 MB of RAM outside the kernel text is
+   mapped by a single PDE, which needs no page table and only one
+   TLB entry. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpu_features ();
+  bool global = (features & CPUID_PGE) != 0;
+  bool large = (features & CPUID_PSE) != 0;
+  uint32_t cr4 = (global ? CR4_PGE : 0) | (large ? CR4_PSE : 0);
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -176,6 +205,17 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      /* The kernel text must stay read-only, so the 4 MB that
+         contain it are mapped page by page. */
+      if (large && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && !(vaddr < &_end_kernel_text && &_start < vaddr + PTSPAN))
+        {
+          pd[pde_idx] = pde_create_large (vaddr) | (global ? PTE_G : 0);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -183,13 +223,18 @@ paging_init (void)
         }
 
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      if (global)
+        pt[pte_idx] |= PTE_G;
     }
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
-     of the Page Directory". */
+     of the Page Directory".  Large pages must be enabled
+     first. */
+  if (cr4 != 0)
+    cpu_set_cr4 (cr4);
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
@@ -252,6 +297,8 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-cache"))
+        cache_sectors = atoi (value);
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -264,6 +311,16 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-zswap"))
+        zswap_pool_pages = atoi (value);
+      else if (!strcmp (name, "-fault-around"))
+        fault_around_pages = atoi (value);
+      else if (!strcmp (name, "-hugepages"))
+        huge_pages_enabled = true;
+      else if (!strcmp (name, "-rss"))
+        rss_limit_default = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -378,6 +435,7 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -cache=COUNT       Cache COUNT file system sectors in RAM.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
@@ -386,6 +444,12 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -zswap=COUNT       Compress up to COUNT pages of swap in RAM.\n"
+          "  -fault-around=COUNT  Map up to COUNT file pages per fault.\n"
+          "  -hugepages         Map large memory regions with 4 MB pages.\n"
+          "  -rss=COUNT         Limit each process to COUNT resident pages.\n"
 #endif
           );
   shutdown_power_off ();
@@ -69,6 +69,16 @@ palloc_init (size_t user_page_limit)
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return palloc_get_aligned (flags, page_cnt, 1);
+}
+
+/* Like palloc_get_multiple(), but the physical address of the
+   first page is a multiple of ALIGN_CNT pages, as 4 MB pages
+   require. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt,
+                    size_t align_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
@@ -78,7 +88,23 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (align_cnt <= 1)
+    page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  else
+    {
+      /* Kernel virtual addresses are physical addresses plus
+         PHYS_BASE, which is aligned, so aligning the page number
+         aligns the physical address too. */
+      size_t end = bitmap_size (pool->used_map);
+      page_idx = ROUND_UP (pg_no (pool->base), align_cnt) - pg_no (pool->base);
+      for (; page_idx + page_cnt <= end; page_idx += align_cnt)
+        if (!bitmap_contains (pool->used_map, page_idx, page_cnt, true))
+          break;
+      if (page_idx + page_cnt <= end)
+        bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      else
+        page_idx = BITMAP_ERROR;
+    }
   lock_release (&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
@@ -113,6 +139,26 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) 
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_cnt (void) 
+{
+  size_t cnt;
+
+  lock_acquire (&user_pool.lock);
+  cnt = bitmap_count (user_pool.used_map, 0, bitmap_size (user_pool.used_map),
+                      false);
+  lock_release (&user_pool.lock);
+  return cnt;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
@@ -210,7 +210,15 @@ thread_create (const char *name, int priority,
   
 #ifdef VM
   init_spt(&t->spt);
+  vma_map_init(&t->vm_map);
   list_init(&t->mmap_list);
+  t->oom_adj = thread_current ()->oom_adj;
+  list_init(&t->frame_maps);
+
+  /* Processes started by user processes inherit their limit,
+     those started by the kernel get the "-rss" default. */
+  t->rss_limit = (thread_current ()->pagedir != NULL
+                  ? thread_current ()->rss_limit : rss_limit_default);
 #endif
 
   /* Add to run queue. */
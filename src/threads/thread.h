@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include "threads/synch.h"
 #include "kernel/hash.h"
+#include "vm/vma.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -123,8 +124,19 @@ struct thread
     struct file *executing_file;
 #endif
     struct hash spt;
+    struct vm_map vm_map;               /* Virtual memory areas. */
     void * esp;
     struct list mmap_list;
+    void *ra_next;                      /* Fault-around: next sequential fault. */
+    size_t ra_window;                   /* Fault-around: current window. */
+    size_t rss_pages;                   /* Frames mapped, for the OOM killer. */
+    size_t swap_pages;                  /* Pages in swap, for the OOM killer. */
+    int oom_adj;                        /* OOM badness bias; see oom_adjust(). */
+    struct list frame_maps;             /* Its frame mappings, as rmap_entrys. */
+    size_t rss_limit;                   /* Most frames to map, or 0; see rss_limit(). */
+    size_t wss_pages;                   /* Working set at the last sample. */
+    int64_t wss_stamp;                  /* Ticks at the last sample. */
+    bool oom_killed;                    /* Chosen by the OOM killer. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -3,18 +3,24 @@
 #include <stdio.h>
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
+#include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/vaddr.h"
 #include "kernel/hash.h"
 #include "vm/spt.h"
-#define MAX_STACK_SIZE 0x800000 // 8MB
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Number of kernel faults on user memory sent to a fixup. */
+static long long fixup_cnt;
+
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -49,7 +55,7 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -70,7 +76,8 @@ exception_init (void)
 void
 exception_print_stats (void) 
 {
-  printf ("Exception: %lld page faults\n", page_fault_cnt);
+  printf ("Exception: %lld page faults, %lld user access fixups\n",
+          page_fault_cnt, fixup_cnt);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -114,6 +121,23 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Handler for a debug exception.  SYSENTER does not clear
+   EFLAGS.TF, so a user program that sets TF just before SYSENTER
+   takes a single-step trap on the first instruction of
+   sysenter_entry, with interrupts off and still on the SYSENTER
+   stack.  Clear TF in the saved flags and let the system call go
+   on; anything else is handled like any other exception. */
+static void
+debug_exception (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG && f->eip == sysenter_entry)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -156,23 +180,33 @@ page_fault (struct intr_frame *f)
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
-  if(!not_present) {
-    //printf("page fault, NOT not_present");
+
+  /* The OOM killer took this process's pages; it dies at its next
+     fault in user mode. */
+  if (user && thread_current()->oom_killed)
     sys_exit(-1);
-  }
-  if((user && is_kernel_vaddr(fault_addr)) || (!user && is_user_vaddr(fault_addr))) {
-    //printf("page fault, user accessed kernel");
+
+  /* Kernel memory is never paged: either a user process reached
+     into it or the kernel has a bug. */
+  if(is_kernel_vaddr(fault_addr)) {
+    //printf("page fault, accessed kernel");
     sys_exit(-1);
   }
-  if((user && is_kernel_vaddr(fault_addr)) || (!user && is_user_vaddr(fault_addr))) {
-    //printf("page fault, kernel accessed user");
-    sys_exit(-1);
+
+  if(!not_present) {
+    /* Writing a page shared copy-on-write by fork(). */
+    if (write && cow_page(&thread_current()->spt, pg_round_down(fault_addr)))
+      return;
+    //printf("page fault, NOT not_present");
+    goto bad_access;
   }
 
   /* Stack growth*/
   spt = &thread_current()->spt;
   upage = pg_round_down(fault_addr);
 
+  /* In kernel mode f->esp is not the user's; the system call
+     handler saved it. */
   if(user) esp = f->esp;
   else esp = thread_current()->esp;
   // stack growth condition
@@ -182,25 +216,34 @@ page_fault (struct intr_frame *f)
   // 2. esp <= fault_addr: stack should be bigger
   bool is_stack_growth = esp <= fault_addr; 
   // 3. push, pusha instruction
-  bool is_push_pusha = fault_addr == f->esp-4 ||fault_addr == f->esp-32; 
+  bool is_push_pusha = fault_addr == esp-4 ||fault_addr == esp-32; 
   // 4. conclusion
   bool addr_cond = is_max_not_reached && is_inside_user_memory;
   bool stack_cond = is_stack_growth || is_push_pusha;
   if(addr_cond&&stack_cond){
-    //if page exists, do not grow.
-    //else, initialize new zero page
-    if(!get_spte(spt,upage)){
-      init_zero_spte(spt, upage);
-    }
+    //extend the stack VMA down to the page; load_page() then
+    //creates a zero page for it.
+    vma_grow_stack(&thread_current()->vm_map, upage);
   }
   /* lazy loading */
-  if (load_page (spt, upage)) {
+  if (load_page (spt, upage, write)) {
      return;
   }
-  else{
-   //printf("load failed");
-   sys_exit(-1);
+
+ bad_access:
+  /* A bad pointer handed to the kernel: if the access came from
+     userprog/uaccess.c, resume at its fixup so that the copy
+     fails and the system call returns an error. */
+  if (!user) {
+    uintptr_t fixup = search_exception_table ((uintptr_t) f->eip);
+    if (fixup != 0) {
+      fixup_cnt++;
+      f->eip = (void (*) (void)) fixup;
+      return;
+    }
   }
+  //printf("load failed");
+  sys_exit(-1);
 
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
@@ -1,13 +1,19 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+
+/* TLB statistics. */
+static long long cr3_load_cnt;    /* # of CR3 loads. */
+static long long cr3_skip_cnt;    /* # of activations of the active PD. */
+static long long invlpg_cnt;      /* # of single-page invalidations. */
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -34,7 +40,7 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if ((*pde & (PTE_P | PTE_PS)) == PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -66,6 +72,15 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no (vaddr);
+  if (*pde & PTE_PS)
+    {
+      /* A large page maps VADDR directly, so there is no PTE to
+         return.  A huge user page must be split with
+         pagedir_split_huge_page() before its 4 kB pages can be
+         changed one at a time. */
+      ASSERT (!create);
+      return NULL;
+    }
   if (*pde == 0) 
     {
       if (create)
@@ -128,6 +143,10 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   uint32_t *pte;
 
   ASSERT (is_user_vaddr (uaddr));
+
+  if (pagedir_is_huge_page (pd, uaddr))
+    return ptov (pd[pd_no (uaddr)] & PTE_ADDR)
+           + ((uintptr_t) uaddr & (PTSPAN - 1));
   
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
@@ -136,6 +155,76 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
     return NULL;
 }
 
+/* Returns true if user virtual address UADDR is mapped in PD by a
+   4 MB page. */
+bool
+pagedir_is_huge_page (uint32_t *pd, const void *uaddr) 
+{
+  return (pd[pd_no (uaddr)] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* Returns true if the 4 MB at user virtual address UPAGE is
+   entirely unused in PD, so that pagedir_set_huge_page() may map
+   it. */
+bool
+pagedir_huge_page_free (uint32_t *pd, const void *upage) 
+{
+  return pd[pd_no (upage)] == 0;
+}
+
+/* Maps the 4 MB at user virtual address UPAGE to the physically
+   contiguous frames at kernel virtual address KPAGE with a
+   single PDE.  Both must be 4 MB aligned, and the range must be
+   unused (see pagedir_huge_page_free()).  Requires CR4.PSE. */
+void
+pagedir_set_huge_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pde = pd + pd_no (upage);
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (*pde == 0);
+
+  *pde = pde_create_large (kpage) | PTE_U;
+  if (!writable)
+    *pde &= ~(uint32_t) PTE_W;
+}
+
+/* Replaces the 4 MB page that maps UPAGE in PD by a page table
+   of 4 kB PTEs for the same frames, which inherit its writable,
+   accessed and dirty bits.  Returns false if no page table could
+   be allocated. */
+bool
+pagedir_split_huge_page (uint32_t *pd, void *upage) 
+{
+  uint32_t *pde = pd + pd_no (upage);
+  uint8_t *kpage = ptov (*pde & PTE_ADDR);
+  uint32_t *pt;
+  size_t i;
+
+  ASSERT (pagedir_is_huge_page (pd, upage));
+
+  pt = palloc_get_page (0);
+  if (pt == NULL)
+    return false;
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = (pte_create_user (kpage + i * PGSIZE, (*pde & PTE_W) != 0)
+             | (*pde & (PTE_A | PTE_D)));
+  *pde = pde_create (pt);
+  invalidate_page (pd, upage);
+  return true;
+}
+
+/* Removes the 4 MB page that maps UPAGE from PD.  Its frames are
+   not freed. */
+void
+pagedir_clear_huge_page (uint32_t *pd, void *upage) 
+{
+  ASSERT (pagedir_is_huge_page (pd, upage));
+  pd[pd_no (upage)] = 0;
+  invalidate_page (pd, upage);
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
@@ -152,7 +241,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,11 +269,39 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Returns true if PD maps virtual page VPAGE writable. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte;
+
+  if (pagedir_is_huge_page (pd, vpage))
+    return (pd[pd_no (vpage)] & PTE_W) != 0;
+  pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  Used for copy-on-write sharing. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_page (pd, vpage);
+    }
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
@@ -209,18 +326,26 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already loaded: a CR3 load flushes
+   every non-global TLB entry, which is wasted work when the
+   address space does not change. */
 void
 pagedir_activate (uint32_t *pd) 
 {
   if (pd == NULL)
     pd = init_page_dir;
+  if (active_pd () == pd)
+    {
+      cr3_skip_cnt++;
+      return;
+    }
+  cr3_load_cnt++;
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
@@ -245,19 +370,32 @@ active_pd (void)
 
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the stale
+   TLB entry.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  The active page directory need not belong to the
+   running thread, since kernel threads keep whatever directory
+   was loaded before them. */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vaddr) 
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      /* INVLPG drops just the one entry, leaving the rest of the
+         TLB intact.  See [IA32-v2a] "INVLPG--Invalidate TLB
+         Entry". */
+      asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+      invlpg_cnt++;
     } 
 }
+
+/* Prints TLB statistics. */
+void
+pagedir_print_stats (void) 
+{
+  printf ("TLB: %lld CR3 loads, %lld skipped, %lld single-page flushes\n",
+          cr3_load_cnt, cr3_skip_cnt, invlpg_cnt);
+}
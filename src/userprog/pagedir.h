@@ -9,10 +9,18 @@ void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+bool pagedir_is_huge_page (uint32_t *pd, const void *upage);
+bool pagedir_huge_page_free (uint32_t *pd, const void *upage);
+void pagedir_set_huge_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_split_huge_page (uint32_t *pd, void *upage);
+void pagedir_clear_huge_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
+bool pagedir_is_writable (uint32_t *pd, const void *upage);
+void pagedir_set_writable (uint32_t *pd, const void *upage, bool writable);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
 void pagedir_activate (uint32_t *pd);
+void pagedir_print_stats (void);
 
 #endif /* userprog/pagedir.h */
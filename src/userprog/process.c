@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <syscall-nr.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -14,6 +15,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -22,7 +24,16 @@
 
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool copy_process (struct thread *parent);
+
+/* Arguments passed from process_fork() to start_fork(). */
+struct fork_args
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Its user context. */
+  };
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -172,6 +183,130 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Starts a new thread running a copy of the current process,
+   which resumes from the system call described by F with a
+   return value of 0.  Like process_execute(), waits until the
+   child has finished copying the parent.  Returns the child's
+   thread id, or TID_ERROR if it could not be created.  The
+   caller must hold the file system lock. */
+tid_t
+process_fork (struct intr_frame *f)
+{
+  struct fork_args args;
+  struct thread *child;
+  tid_t tid;
+
+  args.parent = thread_current ();
+  args.if_ = *f;
+  tid = thread_create (thread_name (), PRI_DEFAULT, start_fork, &args);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  child = find_current_child (tid);
+  sema_down (&child->execute_lock);
+  if (child->isloaded == false)
+    tid = TID_ERROR;
+  sema_up (&child->check_load_lock);
+  return tid;
+}
+
+/* A thread function that copies the forking process and starts
+   the copy running. */
+static void
+start_fork (void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = args->if_;
+  bool success;
+
+  success = copy_process (args->parent);
+  cur->isloaded = success;
+
+  /* Wake up parent waiting for the copy.  ARGS is on the
+     parent's stack, so it is gone after this. */
+  sema_up (&cur->execute_lock);
+  sema_down (&cur->check_load_lock);
+
+  if (!success)
+    thread_exit ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the current thread a copy of PARENT's address space,
+   executable, open files and memory mappings.  Memory is not
+   copied: pages are shared copy-on-write, so this takes time
+   proportional to the number of mapped pages.  Runs while PARENT
+   waits in process_fork(), holding the file system lock. */
+static bool
+copy_process (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  int i;
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    return false;
+  process_activate ();
+
+  if (parent->executing_file != NULL)
+    {
+      t->executing_file = file_reopen (parent->executing_file);
+      if (t->executing_file == NULL)
+        return false;
+      file_deny_write (t->executing_file);
+    }
+
+  for (i = 2; i < 128; i++)
+    if (parent->fd[i] != NULL)
+      {
+        t->fd[i] = file_reopen (parent->fd[i]);
+        if (t->fd[i] == NULL)
+          return false;
+        file_seek (t->fd[i], file_tell (parent->fd[i]));
+      }
+
+#ifdef VM
+  struct list_elem *e;
+  bool success;
+
+  for (e = list_begin (&parent->mmap_list); e != list_end (&parent->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_file *pm = list_entry (e, struct mmap_file, mmap_file_elem);
+      struct mmap_file *cm = malloc (sizeof *cm);
+      if (cm == NULL)
+        return false;
+      cm->file = file_reopen (pm->file);
+      if (cm->file == NULL)
+        {
+          free (cm);
+          return false;
+        }
+      cm->id = pm->id;
+      cm->upage = pm->upage;
+      list_push_back (&t->mmap_list, &cm->mmap_file_elem);
+    }
+
+  /* Huge pages are split, so that their frames can be shared
+     copy-on-write one at a time. */
+  if (!frame_split_huge_all (parent))
+    return false;
+  frame_lock_acquire ();
+  success = fork_spt (t, parent);
+  frame_lock_release ();
+  return success;
+#else
+  /* Sharing pages copy-on-write needs the supplemental page
+     table. */
+  return false;
+#endif
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -216,15 +351,39 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* A process killed inside a system call may still hold the
+     file system lock, which munmap needs. */
+  if (lock_held_by_current_thread (&file_lock))
+    lock_release (&file_lock);
+
 #ifdef VM
-  /* close all mmap files */
+  struct list_elem *e, *next;
+
+  /* Freeing our pages here races with the OOM killer reclaiming
+     them, so keep it away. */
+  cur->oom_adj = OOM_ADJ_MIN;
+
+  /* unmap all mmap files, writing back dirty pages */
+  for (e = list_begin (&cur->mmap_list); e != list_end (&cur->mmap_list);
+       e = next)
+    {
+      struct mmap_file *mmf = list_entry (e, struct mmap_file, mmap_file_elem);
+      next = list_next (e);
+      sys_munmap(mmf->id);
+    }
+
+  /* destroy SPT and VMAs */
+  destroy_spt(&cur->spt);
+  vma_map_destroy(&cur->vm_map);
+
+  /* close the files of mappings munmap had to keep */
   while (!list_empty(&cur->mmap_list)) {
     struct mmap_file *mmf = list_entry (list_pop_front (&cur->mmap_list), struct mmap_file, mmap_file_elem);
-    sys_munmap(mmf->id);
+    lock_acquire (&file_lock);
+    file_close(mmf->file);
+    lock_release (&file_lock);
+    free(mmf);
   }
-
-  /* destroy SPT */
-  destroy_spt(&cur->spt);
 #endif
 
   /* Allow writes to executables. */
@@ -264,8 +423,11 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A kernel thread has none and
+     uses only kernel mappings, which every page directory
+     contains, so it keeps whichever one is loaded. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -530,6 +692,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  /* Lazy load: the segment is described once, and its pages are
+     read or zeroed on the first fault. */
+  return vma_add (&thread_current ()->vm_map, upage,
+                  upage + read_bytes + zero_bytes, VMA_SEGMENT,
+                  read_bytes > 0 ? file : NULL, ofs, read_bytes,
+                  writable) != NULL;
+#else
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
@@ -539,11 +709,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-#ifdef VM
-      // Lazy load
-      init_file_spte(&thread_current ()->spt, upage, file, ofs, page_read_bytes, page_zero_bytes, writable);
-      
-#else
       /* Get a page of memory. */
       uint8_t *kpage = falloc_get_page (PAL_USER, upage);
       if (kpage == NULL)
@@ -563,17 +728,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           falloc_free_page (kpage);
           return false; 
         }
-#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
       upage += PGSIZE;
-#ifdef VM
-      ofs += page_read_bytes;
-#endif
     }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -587,9 +749,13 @@ setup_stack (void **esp)
   kpage = falloc_get_page (PAL_USER | PAL_ZERO, PHYS_BASE - PGSIZE);
   if (kpage != NULL) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true)
+                && vma_add (&thread_current ()->vm_map,
+                            ((uint8_t *) PHYS_BASE) - PGSIZE, PHYS_BASE,
+                            VMA_STACK, NULL, 0, 0, true) != NULL;
       if (success){
         init_frame_spte(&thread_current()->spt,PHYS_BASE-PGSIZE, kpage);
+        falloc_unpin (kpage);
         *esp = PHYS_BASE;
       }
       else
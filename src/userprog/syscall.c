@@ -1,6 +1,9 @@
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include <syscall-nr.h>
@@ -9,6 +12,7 @@
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/off_t.h"
@@ -16,7 +20,10 @@
 #include "devices/shutdown.h"
 #include "devices/input.h"
 #include "threads/synch.h"
+#include "vm/frame.h"
 #include "vm/spt.h"
+#include "vm/swap.h"
+#include "vm/vma.h"
 
 struct lock file_lock;
 struct file 
@@ -27,6 +34,10 @@ struct file
 };
 
 static void syscall_handler (struct intr_frame *);
+static bool mmap_writeback (struct thread *, struct spte *);
+static bool mmap_writeback_locked (struct thread *, struct spte *);
+static void pin_buffer (const void *, unsigned size, bool write);
+static char *copy_in_string (const char *);
 
 void
 syscall_init (void) 
@@ -35,157 +46,227 @@ syscall_init (void)
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
-/* Use is_user_vaddr from src/threads/vaddr.h */
-void
-check_vaddr (const void *vaddr)
+/* Faults in and pins size bytes at buffer for a system call to read
+   (or write, if write), so that it cannot fault under file_lock.
+   Exits if the buffer is not valid user memory.  Release with
+   unpin_user_pages().  Unlike the string arguments, buffers are
+   not bounced through copy_from_user(): the file system reads and
+   writes them in place. */
+static void
+pin_buffer (const void *buffer, unsigned size, bool write)
 {
-  if (!is_user_vaddr (vaddr)) {
-    //printf("not user vaddr");
-    sys_exit(-1);
-  }
+  if (!pin_user_pages (buffer, size, write))
+    sys_exit (-1);
 }
 
-/* syscall handler implementation. */
-static void
-syscall_handler (struct intr_frame *f UNUSED) 
+/* Copies the null-terminated string ustr from user memory into a
+   new kernel page, truncated to fit, so that the file system can
+   use it under file_lock without faulting.  Exits if ustr is not
+   valid user memory.  Free the copy with palloc_free_page(). */
+static char *
+copy_in_string (const char *ustr)
 {
-  /* exit when address is invalid. */
-  check_vaddr(f->esp);
-  void *esp = f->esp;
-  thread_current()->esp = f->esp;
-
-  /* getting syscall number and arguments from frame. */
-  uint32_t syscall_number =  *(uint32_t *)esp;
-  uint32_t argv[3];
-  argv[0] = *(uint32_t *)(esp + 4);
-  argv[1] = *(uint32_t *)(esp + 8);
-  argv[2] = *(uint32_t *)(esp + 12);
-  
-  check_vaddr(esp + 4);
-  check_vaddr(esp + 8);
-  check_vaddr(esp + 12);
-
-  /* call syscall functions according to syscall number. */
-  switch (syscall_number) {
-    case SYS_HALT:                    // syscall0
-      sys_halt();
-      break;
-
-    case SYS_EXIT: {                  // syscall1: int status
-      int status = (int)argv[0];
-      sys_exit(status);
-      break;
-    }
-
-    case SYS_EXEC: {                  // syscall1: const char *file
-      const char *file = (const char *)argv[0];
-      if(file==NULL) {
-        //printf("SYS_EXEC file null");
-        sys_exit(-1);
-      }
-      f->eax = sys_exec(file);
-      break;
-    }
-
-    case SYS_WAIT: {                  // syscall1: pid_t pid
-      int pid = (int)argv[0];
-      f->eax = sys_wait(pid);
-      break;
-    }
-
-    case SYS_CREATE: {                // syscall2: const char *file, unsigned initial_size
-      const char *file = (const char *)argv[0];
-      unsigned initial_size = (unsigned)argv[1];
-      if(file==NULL) {
-        //printf("SYS_CREATE file null");
-        sys_exit(-1);
-      }
-      f->eax = sys_create(file, initial_size);
-      break;
-    }
+  char *kstr = palloc_get_page (0);
+  int len;
+
+  if (kstr == NULL)
+    sys_exit (-1);
+  len = strncpy_from_user (kstr, ustr, PGSIZE);
+  if (len < 0) {
+    palloc_free_page (kstr);
+    sys_exit (-1);
+  }
+  kstr[len < PGSIZE ? len : PGSIZE - 1] = '\0';
+  return kstr;
+}
 
-    case SYS_REMOVE: {                // syscall1: const char *file
-      const char *file = (const char *)argv[0];
-      if(file==NULL) {
-        //printf("SYS_REMOVE file null");
-        sys_exit(-1);
-      }
-      f->eax = sys_remove(file);
-      break;
-    }
+/* Types of system call arguments, which syscall_dispatch()
+   checks and converts before calling the implementation. */
+enum arg_type
+  {
+    ARG_INT,                    /* Integer or handle, passed as is. */
+    ARG_ADDR,                   /* User address, passed as is. */
+    ARG_BUF,                    /* User buffer; exits if null. */
+    ARG_STR,                    /* User string; exits if null, else
+                                   passed as a copy in a kernel page. */
+    ARG_FRAME                   /* The caller's struct intr_frame;
+                                   takes no word from the user stack. */
+  };
+
+/* Types of system call return values. */
+enum ret_type
+  {
+    RET_VOID,                   /* Returns nothing; EAX gets 0. */
+    RET_INT,                    /* int, unsigned, or pid_t. */
+    RET_BOOL                    /* bool, only AL of which is defined. */
+  };
 
-    case SYS_OPEN: {                  // syscall1: const char *file
-      const char *file = (const char *)argv[0];
-      if(file==NULL) {
-        //printf("SYS_OPEN file null");
-        sys_exit(-1);
-      }
-      f->eax = sys_open(file);
-      break;
-    }
+#define SYSCALL_MAX_ARGS 3
 
-    case SYS_FILESIZE: {              // syscall1: int fd
-      int fd = (int)argv[0];
-      f->eax = sys_filesize(fd);
-      break;
-    }
+/* A system call's implementation and signature. */
+struct syscall
+  {
+    void (*func) (void);        /* Implementation, cast for the table. */
+    int argc;                   /* Number of arguments. */
+    enum arg_type args[SYSCALL_MAX_ARGS];
+    enum ret_type ret;
+  };
+
+/* Every implementation is called with three words, as the i386
+   calling convention lets a function ignore arguments it does not
+   take. */
+typedef uint32_t syscall_func (uint32_t, uint32_t, uint32_t);
+
+#define SYSCALL(FUNC, RET, ARGC, ...) \
+        { (void (*) (void)) (FUNC), ARGC, { __VA_ARGS__ }, RET }
+
+/* System calls, indexed by number.  Unimplemented ones are null. */
+static const struct syscall syscalls[] =
+  {
+    [SYS_HALT] = SYSCALL (sys_halt, RET_VOID, 0),
+    [SYS_EXIT] = SYSCALL (sys_exit, RET_VOID, 1, ARG_INT),
+    [SYS_EXEC] = SYSCALL (sys_exec, RET_INT, 1, ARG_STR),
+    [SYS_WAIT] = SYSCALL (sys_wait, RET_INT, 1, ARG_INT),
+    [SYS_CREATE] = SYSCALL (sys_create, RET_BOOL, 2, ARG_STR, ARG_INT),
+    [SYS_REMOVE] = SYSCALL (sys_remove, RET_BOOL, 1, ARG_STR),
+    [SYS_OPEN] = SYSCALL (sys_open, RET_INT, 1, ARG_STR),
+    [SYS_FILESIZE] = SYSCALL (sys_filesize, RET_INT, 1, ARG_INT),
+    [SYS_READ] = SYSCALL (sys_read, RET_INT, 3, ARG_INT, ARG_BUF, ARG_INT),
+    [SYS_WRITE] = SYSCALL (sys_write, RET_INT, 3, ARG_INT, ARG_BUF, ARG_INT),
+    [SYS_SEEK] = SYSCALL (sys_seek, RET_VOID, 2, ARG_INT, ARG_INT),
+    [SYS_TELL] = SYSCALL (sys_tell, RET_INT, 1, ARG_INT),
+    [SYS_CLOSE] = SYSCALL (sys_close, RET_VOID, 1, ARG_INT),
+    [SYS_MMAP] = SYSCALL (sys_mmap, RET_INT, 2, ARG_INT, ARG_ADDR),
+    [SYS_MUNMAP] = SYSCALL (sys_munmap, RET_VOID, 1, ARG_INT),
+    [SYS_FORK] = SYSCALL (sys_fork, RET_INT, 1, ARG_FRAME),
+    [SYS_MSYNC] = SYSCALL (sys_msync, RET_VOID, 1, ARG_INT),
+    [SYS_MADVISE] = SYSCALL (sys_madvise, RET_INT, 3,
+                             ARG_ADDR, ARG_INT, ARG_INT),
+    [SYS_MMAP2] = SYSCALL (sys_mmap2, RET_INT, 3, ARG_INT, ARG_ADDR, ARG_INT),
+    [SYS_OOM_ADJUST] = SYSCALL (sys_oom_adjust, RET_VOID, 1, ARG_INT),
+    [SYS_RSS_LIMIT] = SYSCALL (sys_rss_limit, RET_INT, 1, ARG_INT),
+  };
+
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+/* Statistics. */
+static long long int_call_cnt;          /* Calls through int $0x30. */
+static long long sysenter_call_cnt;     /* Calls through SYSENTER. */
+
+/* Runs the system call whose number and arguments are on the user
+   stack at usp, for a caller whose interrupt frame is f, and returns
+   the value for EAX.  Reads only the words the call takes, each with
+   a single get_user(), and exits if any is not valid user memory.
+   Unknown system calls return -1. */
+static uint32_t
+syscall_dispatch (const uint32_t *usp, struct intr_frame *f)
+{
+  struct thread *t = thread_current();
+  const struct syscall *sc;
+  const uint32_t *uarg = usp + 1;
+  uint32_t number, argv[SYSCALL_MAX_ARGS] = { 0, 0, 0 };
+  uint32_t ret;
+  int i;
+
+  t->esp = (void *) usp;
+  if (t->oom_killed || !get_user (&number, usp))
+    sys_exit(-1);
+  if (number >= SYSCALL_CNT || syscalls[number].func == NULL)
+    return -1;
+  sc = &syscalls[number];
 
-    case SYS_READ: {                  // syscall3: int fd, void *buffer, unsigned size
-      int fd = (int)argv[0];
-      void *buffer = (void *)argv[1];
-      unsigned size = (unsigned)argv[2];
-      if(buffer==NULL) {
-        //printf("SYS_READ buffer null");
-        sys_exit(-1);
-      }
-      f->eax = sys_read(fd, buffer, size);
-      break;
+  for (i = 0; i < sc->argc; i++) {
+    if (sc->args[i] == ARG_FRAME) {
+      argv[i] = (uint32_t) f;
+      continue;
     }
+    if (!get_user (&argv[i], uarg++))
+      goto bad_arg;
+    if ((sc->args[i] == ARG_BUF || sc->args[i] == ARG_STR) && argv[i] == 0)
+      goto bad_arg;
+    if (sc->args[i] == ARG_STR)
+      argv[i] = (uint32_t) copy_in_string ((const char *) argv[i]);
+  }
 
-    case SYS_WRITE: {                 // syscall3: int fd, const void *buffer, unsigned size
-      int fd = (int)argv[0];
-      const void *buffer = (const void *)argv[1];
-      unsigned size = (unsigned)argv[2];
-      if(buffer==NULL) {
-        //printf("sys_write buffer null");
-        sys_exit(-1);
-      }
-      f->eax = sys_write(fd, buffer, size);
-      break;
-    }
+  ret = ((syscall_func *) sc->func) (argv[0], argv[1], argv[2]);
+  if (sc->ret == RET_VOID)
+    ret = 0;
+  else if (sc->ret == RET_BOOL)
+    ret = (uint8_t) ret != 0;
 
-    case SYS_SEEK: {                  // syscall2: int fd, unsigned position
-      int fd = (int)argv[0];
-      unsigned position = (unsigned)argv[1];
-      sys_seek(fd, position);
-      break;
-    }
+  for (i = 0; i < sc->argc; i++)
+    if (sc->args[i] == ARG_STR)
+      palloc_free_page ((void *) argv[i]);
 
-    case SYS_TELL: {                  // syscall1: int fd
-      int fd = (int)argv[0];
-      f->eax = sys_tell(fd);
-      break;
-    }
+  /* Chosen by the OOM killer during the call: its memory is gone,
+     so it must not go back to user mode. */
+  if (t->oom_killed)
+    sys_exit(-1);
+  return ret;
+
+ bad_arg:
+  while (i-- > 0)
+    if (sc->args[i] == ARG_STR)
+      palloc_free_page ((void *) argv[i]);
+  sys_exit(-1);
+  NOT_REACHED ();
+}
 
-    case SYS_CLOSE: {                 // syscall1: int fd
-      int fd = (int)argv[0];
-      sys_close(fd);
-      break;
-    }
+/* System call entry through int $0x30. */
+static void
+syscall_handler (struct intr_frame *f) 
+{
+  int_call_cnt++;
+  f->eax = syscall_dispatch (f->esp, f);
+}
 
-    case SYS_MMAP: {                 // syscall2: int fd, void * addr
-      int fd = (int)argv[0];
-      void * addr = (void *)argv[1];
-      f->eax = sys_mmap(fd,addr);
-      break;
-    }
+/* User context saved by sysenter_entry, in sysenter.S. */
+struct sysenter_frame
+  {
+    uint32_t edi, esi, ebx, ebp;        /* Callee-saved registers. */
+    uint16_t es, :16;                   /* Data segments. */
+    uint16_t ds, :16;
+    void (*eip) (void);                 /* Return address, from EDX. */
+    void *esp;                          /* Stack pointer, from ECX. */
+    uint32_t eflags;                    /* User's flags. */
+  };
+
+uint32_t sysenter_handler (struct sysenter_frame *);
+
+/* System call entry through SYSENTER.  Only fork() needs a full
+   interrupt frame, to start the child from, so one is built just
+   for it; the child returns to user mode through intr_exit. */
+uint32_t
+sysenter_handler (struct sysenter_frame *sf)
+{
+  struct intr_frame f;
+  uint32_t number;
+
+  sysenter_call_cnt++;
+  if (!get_user (&number, sf->esp) || number != SYS_FORK)
+    return syscall_dispatch (sf->esp, NULL);
+
+  memset (&f, 0, sizeof f);
+  f.edi = sf->edi;
+  f.esi = sf->esi;
+  f.ebx = sf->ebx;
+  f.ebp = sf->ebp;
+  f.es = sf->es;
+  f.ds = sf->ds;
+  f.fs = f.gs = f.ss = SEL_UDSEG;
+  f.cs = SEL_UCSEG;
+  f.eip = sf->eip;
+  f.esp = sf->esp;
+  f.eflags = sf->eflags;
+  return syscall_dispatch (sf->esp, &f);
+}
 
-    case SYS_MUNMAP: {                 // syscall1: mapid_t mapping
-      mapid_t mapping = (mapid_t)argv[0];
-      sys_munmap(mapping);
-      break;
-    }
-  }
+/* Prints system call statistics. */
+void
+syscall_print_stats (void)
+{
+  printf ("System calls: %lld through int $0x30, %lld through sysenter\n",
+          int_call_cnt, sysenter_call_cnt);
 }
 
 /* syscall logic implementations. */
@@ -230,7 +311,7 @@ sys_wait(int pid)
 /* Return file pointer according to fd number. */
 struct file *
 fd_to_file(int fd){
-  if(fd<0 || fd>128) {
+  if(fd<0 || fd>=128) {
     //printf("fd_to_file fd error null");
     sys_exit(-1);
   }
@@ -281,9 +362,8 @@ sys_open (const char *file)
   lock_acquire (&file_lock);
   struct file *return_file = filesys_open (file);
   lock_release(&file_lock);
-  if (return_file == NULL) {
+  if (return_file == NULL)
     return -1;
-  }
   for (int i=2; i<128; i++)
   {
     if (thread_current()->fd[i] == NULL)
@@ -297,6 +377,9 @@ sys_open (const char *file)
       return i;
     }
   }
+  lock_acquire (&file_lock);
+  file_close (return_file);
+  lock_release (&file_lock);
   return -1;
 }
 
@@ -330,23 +413,30 @@ keyboard_read(void *buffer, unsigned size){
 int
 sys_read (int fd, void *buffer, unsigned size)
 {
-  check_vaddr (buffer);
-  check_vaddr (buffer+size-1);
+  int bytes_read = 0;
+
+  if (fd != 0 && fd != 1)
+    fd_to_file(fd);
+  /* pin the buffer first, so the copy cannot fault. */
+  pin_buffer (buffer, size, true);
   switch (fd)
   {
   case 0:   // STDIN
-    return keyboard_read(buffer, size);
+    bytes_read = keyboard_read(buffer, size);
+    break;
   case 1:   // STDOUT
-    return 0;
+    break;
   default:  // File
     {
       struct file *f = fd_to_file(fd);
       lock_acquire (&file_lock);
-      int bytes_read = file_read (f, buffer, size);
+      bytes_read = file_read (f, buffer, size);
       lock_release (&file_lock);
-      return bytes_read;
+      break;
     }
   }
+  unpin_user_pages (buffer, size);
+  return bytes_read;
 }
 
 /* Writes size bytes from buffer to the open file fd.
@@ -354,23 +444,29 @@ sys_read (int fd, void *buffer, unsigned size)
     which may be less than size if some bytes could not be written.
   - The expected behavior is to write as many bytes as possible up to end-of-file 
     and return the actual number written, or 0 if no bytes could be written at all.
-  - Fd 1 writes to the console.  */
+  - Fd 1 writes to the console.
+  The buffer is pinned first, so the copy cannot fault. */
 int
 sys_write (int fd, const void *buffer, unsigned size)
 {
+  int res = size;
+
+  if (fd != 1)
+    fd_to_file(fd);
+  pin_buffer (buffer, size, false);
   if (fd == 1){
     lock_acquire (&file_lock);
     putbuf (buffer, size);
     lock_release (&file_lock);
-    return size;
   }
   else{
     struct file *f = fd_to_file(fd);
     lock_acquire (&file_lock);
-    int res =  file_write (f, buffer, size);
+    res =  file_write (f, buffer, size);
     lock_release (&file_lock);
-    return res;
   }
+  unpin_user_pages (buffer, size);
+  return res;
 }
 
 /* Changes the next byte to be read or written in open file fd to position, 
@@ -410,11 +506,10 @@ void
 sys_close (int fd)
 {
   struct file *f = fd_to_file(fd);
+  thread_current()->fd[fd] = NULL;
   lock_acquire (&file_lock);
-  f = NULL;
   file_close (f);
   lock_release (&file_lock);
-  return;
 }
 
 /* Maps the file open as fd into the process's virtual address space. 
@@ -422,6 +517,14 @@ sys_close (int fd)
  starting at addr. */
 mapid_t
 sys_mmap (int fd, void *addr)
+{
+  return sys_mmap2(fd, addr, 0);
+}
+
+/* Like mmap, with FLAGS.  MAP_POPULATE reads the whole mapping in
+ before returning, instead of one page fault at a time. */
+mapid_t
+sys_mmap2 (int fd, void *addr, int flags)
 {
   // mmap-misalign, mmap-null test case
   if (addr == NULL ||(int) addr % PGSIZE != 0) {
@@ -436,34 +539,31 @@ sys_mmap (int fd, void *addr)
 	  return -1;
   }
 
+  off_t size = file_length(opened_file);
+  void *end = addr + ROUND_UP(size, PGSIZE);
+  struct vm_map *map = &thread_current()->vm_map;
+
+  /* the whole range must be free user address space.
+     One VMA describes it; pages get an spte when first touched. */
+  if (size > 0 && (!is_user_vaddr(end - 1) || end < addr
+                   || vma_add(map, addr, end, VMA_MMAP, opened_file, 0,
+                              size, true) == NULL)) {
+    file_close(opened_file);
+    lock_release (&file_lock);
+    return -1;
+  }
+
   struct mmap_file *mmf;
   mmf = (struct mmap_file *) malloc(sizeof *mmf);
   mmf->id = new_mmapid(thread_current());
   mmf->file = opened_file;
   mmf->upage = addr;
 
-  off_t ofs;
-  int size = file_length(opened_file);
-  struct hash *spt = &thread_current()->spt;
-
-  /* check if all pages do not exist.*/
-  for (ofs = 0; ofs < size; ofs += PGSIZE){
-    if (get_spte(spt, addr + ofs)) {
-	    lock_release (&file_lock);
-      return -1;
-    }
-  }
-
-  /* map each page */
-  for (ofs = 0; ofs < size; ofs += PGSIZE) {
-      uint32_t read_bytes = ofs + PGSIZE < size ? PGSIZE : size - ofs;
-      init_file_spte(spt, addr, opened_file, ofs, read_bytes, PGSIZE - read_bytes, true);
-      addr += PGSIZE;
-  }
-
   /* add to list */
   list_push_back(&thread_current()->mmap_list, &mmf->mmap_file_elem);
   lock_release (&file_lock);
+  if (flags & MAP_POPULATE)
+    prefault_pages(&thread_current()->spt, addr, end);
   return mmf->id;
 }
 
@@ -479,7 +579,9 @@ new_mmapid(struct thread* t){
 
 /* Unmaps the mapping designated by mapping, which must be a 
 mapping ID returned by a previous call to mmap by the same process 
-that has not yet been unmapped. */
+that has not yet been unmapped.  If a page cannot be written back or
+dropped, the mapping is left in place, since that page still refers
+to the file; process_exit() closes the file once the pages are gone. */
 void
 sys_munmap (mapid_t mapping)
 {
@@ -487,26 +589,32 @@ sys_munmap (mapid_t mapping)
   struct mmap_file *mmf = get_mmf(t, mapping);
   if(mmf==NULL) return; // invalid mapping id
   lock_acquire (&file_lock);
+  off_t length = file_length(mmf->file);
+  lock_release (&file_lock);
 
+  struct vma *vma = vma_find(&t->vm_map, mmf->upage);
+  bool kept = false;
   off_t ofs;
   void *upage;
-  for (ofs = 0; ofs < file_length(mmf->file); ofs += PGSIZE) {
+  for (ofs = 0; ofs < length; ofs += PGSIZE) {
     upage = mmf->upage + ofs;
     struct spte *entry = get_spte(&t->spt, upage);
+    if (entry == NULL) continue; // never touched
 
-    // dirty page check
-    if (pagedir_is_dirty(t->pagedir, upage)) {
-        void *kpage = pagedir_get_page(t->pagedir, upage);
-        file_write_at(entry->file, kpage, entry->read_bytes, entry->file_offset);
-    }
-
-    // remove page
-    page_delete(&t->spt, entry);
+    // write back if changed, then remove page; a page that
+    // could not be written is kept, with the mapping
+    if (!mmap_writeback(t, entry) || !page_delete(&t->spt, entry))
+      kept = true;
   }
+  if (kept) return;
 
-  // remove from list
+  // remove from lists
+  if (vma != NULL) vma_remove(&t->vm_map, vma);
   list_remove(&mmf->mmap_file_elem);
+  lock_acquire (&file_lock);
+  file_close(mmf->file);
   lock_release (&file_lock);
+  free(mmf);
   return;
 }
 
@@ -525,4 +633,171 @@ get_mmf(struct thread *t, mapid_t mapping) {
     }
   }
   return NULL;
-}
\ No newline at end of file
+}
+
+/* Creates a copy of the current process that resumes from the
+   same system call with fork() returning 0.  Returns the child's
+   pid, or -1 if it could not be created. */
+int
+sys_fork (struct intr_frame *f)
+{
+  lock_acquire (&file_lock);
+  int pid = process_fork (f);
+  lock_release (&file_lock);
+  return pid;
+}
+
+/* Writes ENTRY's page of a file mapping back to the file if it may
+   have changed, and marks it clean.  Eviction drops clean pages, so
+   a swapped-out page is dirty: it is read back in, still marked
+   dirty, and written.  The page is pinned while it is written.
+   Under memory pressure there may be no frame to pin it in, and
+   then mmap_writeback_locked() writes it without one.  This runs
+   from process_exit() through sys_munmap(), so it must not exit.
+   Returns false only if the page could not be written.  Caller
+   must not hold file_lock. */
+static bool
+mmap_writeback (struct thread *t, struct spte *entry)
+{
+  if (entry->status != FRAME_PAGE && entry->status != SWAP_PAGE)
+    return true;
+  if (!pin_user_pages(entry->upage, PGSIZE, false))
+    return mmap_writeback_locked(t, entry);
+  if (pagedir_is_dirty(t->pagedir, entry->upage)) {
+    lock_acquire (&file_lock);
+    file_write_at(entry->file, entry->kpage, entry->read_bytes, entry->file_offset);
+    lock_release (&file_lock);
+    pagedir_set_dirty(t->pagedir, entry->upage, false);
+  }
+  unpin_user_pages(entry->upage, PGSIZE);
+  return true;
+}
+
+/* Writes back ENTRY's page without a frame to pin it in.  A
+   resident page is written from its frame, which frame_lock keeps
+   from being evicted meanwhile.  A swapped-out page is read into
+   a kernel buffer and written from there; as the file then holds
+   its data, it is read from the file on the next fault.  Returns
+   false if there was no memory for the buffer. */
+static bool
+mmap_writeback_locked (struct thread *t, struct spte *entry)
+{
+  bool success = true;
+
+  lock_acquire (&file_lock);
+  frame_lock_acquire ();
+  if (entry->status == FRAME_PAGE) {
+    if (pagedir_is_dirty(t->pagedir, entry->upage)) {
+      file_write_at(entry->file, entry->kpage, entry->read_bytes, entry->file_offset);
+      pagedir_set_dirty(t->pagedir, entry->upage, false);
+    }
+  } else if (entry->status == SWAP_PAGE) {
+    void *buffer = malloc(PGSIZE);
+    if (buffer != NULL) {
+      swap_in(entry->swap_id, buffer);
+      file_write_at(entry->file, buffer, entry->read_bytes, entry->file_offset);
+      free(buffer);
+      entry->status = FILE_PAGE;
+      entry->swap_id = -1;
+      t->swap_pages--;
+    } else
+      success = false;
+  }
+  frame_lock_release ();
+  lock_release (&file_lock);
+  return success;
+}
+
+/* Writes the changed pages of mapping back to its file, without
+   unmapping it. */
+void
+sys_msync (mapid_t mapping)
+{
+  struct thread *t = thread_current();
+  struct mmap_file *mmf = get_mmf(t, mapping);
+  if(mmf==NULL) return; // invalid mapping id
+  lock_acquire (&file_lock);
+  off_t length = file_length(mmf->file);
+  lock_release (&file_lock);
+
+  off_t ofs;
+  for (ofs = 0; ofs < length; ofs += PGSIZE) {
+    struct spte *entry = get_spte(&t->spt, mmf->upage + ofs);
+    if (entry != NULL)
+      mmap_writeback(t, entry);
+  }
+}
+
+/* Advises the kernel how the pages from addr to addr + length will
+   be used.
+  - MADV_NORMAL, MADV_RANDOM and MADV_SEQUENTIAL set the fault-around
+    policy of the areas that overlap the range.
+  - MADV_WILLNEED reads the range in now.
+  - MADV_DONTNEED drops the range's pages.  Mapped files are written
+    back first; other pages read as their initial contents again.
+  Returns 0 on success, -1 if addr is not page-aligned, the range is
+  not in user memory or advice is unknown. */
+int
+sys_madvise (void *addr, size_t length, int advice)
+{
+  struct thread *t = thread_current();
+  uint8_t *start = addr;
+  uint8_t *end = start + ROUND_UP(length, PGSIZE);
+  uint8_t *upage;
+
+  if (pg_ofs(addr) != 0 || end < start || (end > start && !is_user_vaddr(end - 1)))
+    return -1;
+
+  switch (advice) {
+    case MADV_NORMAL:
+    case MADV_RANDOM:
+    case MADV_SEQUENTIAL:
+      vma_set_advice(&t->vm_map, start, end, advice);
+      return 0;
+
+    case MADV_WILLNEED:
+      prefault_pages(&t->spt, start, end);
+      return 0;
+
+    case MADV_DONTNEED:
+      for (upage = start; upage < end; upage += PGSIZE) {
+        struct spte *entry = get_spte(&t->spt, upage);
+        if (entry == NULL) continue;
+        struct vma *vma = vma_find(&t->vm_map, upage);
+        if (vma != NULL && vma->kind == VMA_MMAP
+            && !mmap_writeback(t, entry))
+          continue;               // keep what could not be written
+        page_delete(&t->spt, entry);
+      }
+      return 0;
+
+    default:
+      return -1;
+  }
+}
+
+/* Sets the current process's OOM badness bias to adj, clamped to
+   OOM_ADJ_MIN...OOM_ADJ_MAX.  Children inherit it. */
+void
+sys_oom_adjust (int adj)
+{
+  if (adj < OOM_ADJ_MIN) adj = OOM_ADJ_MIN;
+  if (adj > OOM_ADJ_MAX) adj = OOM_ADJ_MAX;
+  thread_current()->oom_adj = adj;
+}
+
+/* Limits the current process to mapping pages frames, evicting its
+   own pages at once if it maps more; 0 removes the limit and a
+   negative value leaves it alone.  Children inherit it.  Returns
+   the process's working set, in pages, as last sampled. */
+int
+sys_rss_limit (int pages)
+{
+  struct thread *t = thread_current();
+
+  if (pages >= 0) {
+    t->rss_limit = pages;
+    frame_trim_rss(t);
+  }
+  return t->wss_pages;
+}
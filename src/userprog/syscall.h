@@ -4,8 +4,13 @@
 #include <stdio.h>
 #include "threads/thread.h"
 
+struct intr_frame;
+
+/* Serializes file system access by user processes. */
+extern struct lock file_lock;
+
 void syscall_init (void);
-void check_vaddr (const void *vaddr);
+void syscall_print_stats (void);
 
 void sys_halt(void);
 void sys_exit(int status);
@@ -25,7 +30,14 @@ int keyboard_read(void *buffer, unsigned size);
 
 typedef int mapid_t;
 mapid_t sys_mmap(int fd, void *addr);
+mapid_t sys_mmap2(int fd, void *addr, int flags);
+void sys_msync(mapid_t mapping);
+int sys_madvise(void *addr, size_t length, int advice);
+void sys_oom_adjust(int adj);
+int sys_rss_limit(int pages);
 mapid_t new_mmapid(struct thread * t);
 void sys_munmap(mapid_t mapping);
 struct mmap_file *get_mmf(struct thread *t, mapid_t mapping);
+
+int sys_fork(struct intr_frame *f);
 #endif /* userprog/syscall.h */
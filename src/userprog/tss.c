@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -75,6 +76,14 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Stack that SYSENTER switches to.  sysenter_entry leaves it
+   at once for the running thread's kernel stack, whose address
+   it finds through the top word, but a debug exception taken on
+   its first instruction, because the user set EFLAGS.TF before
+   SYSENTER, pushes an interrupt frame here. */
+#define SYSENTER_STACK_WORDS 256
+static uint32_t sysenter_stack[SYSENTER_STACK_WORDS];
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -88,6 +97,32 @@ tss_init (void)
   tss_update ();
 }
 
+/* Points the SYSENTER model-specific registers at sysenter_entry,
+   if the CPU has them, so that user programs can enter system
+   calls without going through an interrupt gate.
+
+   SYSENTER loads ESP from an MSR, which would have to be rewritten
+   at every thread switch to track the running thread's kernel
+   stack.  Instead it points at the top of sysenter_stack, which
+   holds the address of the TSS's esp0 member, which tss_update()
+   already keeps current, and sysenter_entry loads the stack
+   pointer from there.  The user segments SYSEXIT returns
+   to are implied by SEL_KCSEG: the GDT lays out kernel code,
+   kernel data, user code, and user data in that order, as SYSENTER
+   and SYSEXIT require. */
+void
+sysenter_init (void)
+{
+  ASSERT (tss != NULL);
+  if ((cpu_features () & CPUID_SEP) == 0)
+    return;
+  cpu_wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  sysenter_stack[SYSENTER_STACK_WORDS - 1] = (uint32_t) &tss->esp0;
+  cpu_wrmsr (MSR_SYSENTER_ESP,
+             (uint32_t) &sysenter_stack[SYSENTER_STACK_WORDS - 1]);
+  cpu_wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+}
+
 /* Returns the kernel TSS. */
 struct tss *
 tss_get (void) 
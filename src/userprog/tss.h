@@ -5,6 +5,8 @@
 
 struct tss;
 void tss_init (void);
+void sysenter_init (void);
+void sysenter_entry (void);
 struct tss *tss_get (void);
 void tss_update (void);
 
@@ -0,0 +1,175 @@
+#include "userprog/uaccess.h"
+#include "threads/vaddr.h"
+
+/* An exception table entry: if the instruction at INSN faults,
+   page_fault() resumes execution at FIXUP.  The entries are
+   emitted into the __ex_table section next to the instructions
+   they cover and collected by the linker script between
+   __start_ex_table and __stop_ex_table. */
+struct exception_table_entry
+  {
+    uintptr_t insn;             /* Address of a user access. */
+    uintptr_t fixup;            /* Where to continue if it faults. */
+  };
+
+extern const struct exception_table_entry __start_ex_table[];
+extern const struct exception_table_entry __stop_ex_table[];
+
+/* Emits an exception table entry for instruction label INSN with
+   fixup label FIXUP, both numeric local labels such as "1b". */
+#define EX_TABLE(INSN, FIXUP)                   \
+        ".pushsection __ex_table, \"a\"\n"      \
+        "  .long " INSN ", " FIXUP "\n"         \
+        ".popsection\n"
+
+/* Returns true if the SIZE bytes at UADDR lie entirely in user
+   space.  This is the only check made before touching them. */
+static inline bool
+user_range_ok (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be in
+   user space, a word at a time and then the tail a byte at a
+   time.  Returns the number of bytes that were not copied because
+   of a fault, so 0 on success. */
+static size_t
+copy_user (void *dst, const void *src, size_t size)
+{
+  size_t left = size / 4;
+  size_t tail = size % 4;
+
+  asm volatile ("1: rep movsl\n"
+                "   movl %3, %0\n"
+                "2: rep movsb\n"
+                "   jmp 4f\n"
+                "3: leal (%3,%0,4), %0\n"
+                "4:\n"
+                EX_TABLE ("1b", "3b")
+                EX_TABLE ("2b", "4b")
+                : "+c" (left), "+S" (src), "+D" (dst)
+                : "r" (tail)
+                : "memory");
+  return left;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Returns false if any of USRC is not valid user memory, in which
+   case DST may have been partly written. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return user_range_ok (usrc, size) && copy_user (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns false if any of UDST is not valid, writable user memory,
+   in which case UDST may have been partly written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return user_range_ok (udst, size) && copy_user (udst, src, size) == 0;
+}
+
+/* Reads the word at user address USRC into *DST with a single
+   load.  Returns false if USRC is not valid user memory. */
+bool
+get_user (uint32_t *dst, const uint32_t *usrc)
+{
+  uint32_t value;
+  int error = 0;
+
+  if (!user_range_ok (usrc, sizeof *usrc))
+    return false;
+  asm volatile ("1: movl %2, %0\n"
+                "   jmp 3f\n"
+                "2: movl $1, %1\n"
+                "3:\n"
+                EX_TABLE ("1b", "2b")
+                : "=r" (value), "+r" (error)
+                : "m" (*usrc));
+  if (error)
+    return false;
+  *dst = value;
+  return true;
+}
+
+/* Writes VALUE to user address UDST with a single store.  Returns
+   false if UDST is not valid, writable user memory. */
+bool
+put_user (uint32_t *udst, uint32_t value)
+{
+  int error = 0;
+
+  if (!user_range_ok (udst, sizeof *udst))
+    return false;
+  asm volatile ("1: movl %2, %0\n"
+                "   jmp 3f\n"
+                "2: movl $1, %1\n"
+                "3:\n"
+                EX_TABLE ("1b", "2b")
+                : "=m" (*udst), "+r" (error)
+                : "r" (value));
+  return !error;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, copying at most SIZE bytes including the null terminator.
+   Returns the length of the string, not counting the null
+   terminator, or SIZE if no null terminator was found within SIZE
+   bytes, in which case DST is not null-terminated.  Returns -1 if
+   the string is not valid user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t limit, left;
+  int error = 0;
+  int scratch;
+
+  if (!is_user_vaddr (usrc))
+    return -1;
+  limit = (size_t) ((const char *) PHYS_BASE - usrc);
+  if (limit > size)
+    limit = size;
+
+  left = limit;
+  asm volatile ("   jecxz 3f\n"
+                "1: lodsb\n"
+                "   stosb\n"
+                "   testb %%al, %%al\n"
+                "   loopnz 1b\n"
+                "   jmp 3f\n"
+                "2: movl $1, %4\n"
+                "3:\n"
+                EX_TABLE ("1b", "2b")
+                : "+c" (left), "+S" (usrc), "+D" (dst), "=&a" (scratch),
+                  "+r" (error)
+                :
+                : "memory");
+  if (error)
+    return -1;
+
+  /* LIMIT - LEFT bytes were stored, the last of them the null
+     terminator if one was found. */
+  if (limit - left > 0 && dst[-1] == '\0')
+    return limit - left - 1;
+  else if (limit < size)
+    return -1;                  /* Runs into kernel space. */
+  else
+    return size;
+}
+
+/* Returns the fixup address for a fault at kernel instruction
+   EIP, or 0 if EIP is not a user access. */
+uintptr_t
+search_exception_table (uintptr_t eip)
+{
+  const struct exception_table_entry *e;
+
+  for (e = __start_ex_table; e < __stop_ex_table; e++)
+    if (e->insn == eip)
+      return e->fixup;
+  return 0;
+}
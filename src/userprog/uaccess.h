@@ -0,0 +1,24 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel access to user memory.
+
+   Each routine checks only that its range lies below PHYS_BASE and
+   then touches user memory directly.  A page fault on an address
+   that cannot be brought in does not kill the process: page_fault()
+   finds the faulting instruction in the exception table and resumes
+   at its fixup, which makes the routine return an error. */
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+bool get_user (uint32_t *dst, const uint32_t *usrc);
+bool put_user (uint32_t *udst, uint32_t value);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+uintptr_t search_exception_table (uintptr_t eip);
+
+#endif /* userprog/uaccess.h */
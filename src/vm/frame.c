@@ -1,9 +1,16 @@
 #include "vm/frame.h"
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
 #include "threads/synch.h"
 #include "threads/palloc.h"
 #include "frame.h"
 #include "spt.h"
 #include "swap.h"
+#include "vm/oom.h"
 // #include "vm/swap.h"
 
 /* Syncronization*/
@@ -12,29 +19,155 @@ static struct lock frame_lock;
 /* Frame Table*/
 static struct list frame_table;
 
+void *zero_frame;
+
 /* Clock Algorithm Pointer */
 static struct fte *clock_ptr;
 
+/* Text cache: frames holding read-only file pages, keyed by
+   inode, offset and length, so that processes running the same
+   executable map the same frames. */
+static struct hash text_cache;
+
+/* Text cache statistics. */
+static size_t text_cached_cnt;    /* Pages added to the cache. */
+static size_t text_shared_cnt;    /* Faults served from it. */
+static size_t text_dropped_cnt;   /* Clean pages evicted without swap. */
+
+/* Writable file pages evicted without swap, because no mapping
+   had written them since they were read from the file. */
+static size_t clean_dropped_cnt;
+
+/* Page-out daemon.  Wakes when free user frames drop below
+   low_wmark and evicts until there are high_wmark free. */
+static struct semaphore kswapd_sema;
+static bool kswapd_running;       /* Daemon started. */
+static bool kswapd_awake;         /* Woken and not yet done. */
+static size_t low_wmark, high_wmark;
+
+/* Page-out daemon statistics. */
+static size_t wmark_hit_cnt;      /* Times free frames fell below low. */
+static size_t kswapd_evict_cnt;   /* Pages evicted by the daemon. */
+static int64_t kswapd_ticks;      /* Timer ticks spent reclaiming. */
+static size_t direct_reclaim_cnt; /* Faults that had to evict. */
+
+/* Huge pages, oldest first. */
+static struct list huge_frames;
+bool huge_pages_enabled;
+
+/* Huge page statistics. */
+static size_t huge_map_cnt;       /* Huge pages mapped. */
+static size_t huge_split_cnt;     /* Split into 4 kB frames. */
+static size_t huge_fail_cnt;      /* Not enough contiguous frames. */
+
+/* Resident set limits.  A process at its limit replaces its own
+   pages, with a second-chance clock over its frame_maps, instead
+   of taking frames from everyone else.  Its working set, the
+   pages it touched in the last WSS_SAMPLE_TICKS, is sampled from
+   the accessed bits as it faults. */
+size_t rss_limit_default;
+#define WSS_SAMPLE_TICKS (TIMER_FREQ / 4)
+
+/* Resident set limit statistics. */
+static size_t local_evict_cnt;    /* Pages evicted at a process's limit. */
+static size_t local_fail_cnt;     /* Nothing of its own to evict. */
+static size_t wss_sample_cnt;     /* Working set samples. */
+static size_t wss_over_cnt;       /* Samples not smaller than the limit. */
+
+/* Copy-on-write statistics. */
+static size_t cow_fault_cnt;      /* Write faults on shared frames. */
+static size_t cow_copy_cnt;       /* Frames copied by them. */
+
+static void *allocate_frame (enum palloc_flags, void *upage, bool may_evict);
+static void free_frame_entry (struct fte *);
+static void unmap_frame_entry (struct fte *, struct thread *);
+static struct fte *new_frame_entry (void *kpage, struct thread *, void *upage);
+static struct fte *clock_next (struct fte *);
+static bool needs_swap (struct fte *);
+static void evict_frame (struct fte *);
+static bool evict_local (struct thread *);
+static void sample_working_set (struct thread *);
+static bool add_share (struct fte *, struct thread *, void *upage);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+static thread_func kswapd NO_RETURN;
+static void check_watermark (void);
+static bool split_huge_frame (struct huge_frame *);
+static struct huge_frame *find_huge_frame (struct thread *, void *upage);
+
 /* Frame Initialization*/
 void
 frame_init ()
 {
     list_init (&frame_table);
     lock_init (&frame_lock);
+    hash_init (&text_cache, text_hash, text_less, NULL);
+    zero_frame = palloc_get_page (PAL_ASSERT | PAL_ZERO);
     clock_ptr = NULL;
+    list_init (&huge_frames);
+    if (!(cpu_features () & CPUID_PSE))
+      huge_pages_enabled = false;
+}
+
+/* Starts the page-out daemon.  Needs swap, which is initialized
+   after the frame table. */
+void
+frame_start_kswapd (void)
+{
+    size_t user_pages = palloc_user_page_cnt ();
+
+    if (swap_free_cnt () == 0)
+      return;
+    low_wmark = user_pages / FRAME_LOW_WMARK_DIV;
+    high_wmark = user_pages / FRAME_HIGH_WMARK_DIV;
+    if (low_wmark < 4)
+      low_wmark = 4;
+    if (high_wmark < 2 * low_wmark)
+      high_wmark = 2 * low_wmark;
+
+    sema_init (&kswapd_sema, 0);
+    kswapd_running = true;
+    thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
 }
 
 /* Allocate page. in setup_stack in process.c, palloc is replaced by falloc. */
 void *
 falloc_get_page(enum palloc_flags flags, void *upage) {
+    return allocate_frame(flags, upage, true);
+}
+
+/* Like falloc_get_page(), but returns a null pointer instead of
+   evicting a page when no frame is free. */
+void *
+falloc_get_free_page(enum palloc_flags flags, void *upage) {
+    return allocate_frame(flags, upage, false);
+}
+
+/* Allocates a frame for UPAGE, evicting another page to make room
+   if MAY_EVICT is true.  A process at its resident set limit
+   evicts one of its own pages first, or gets no frame if it may
+   not evict. */
+static void *
+allocate_frame(enum palloc_flags flags, void *upage, bool may_evict) {
+    struct thread *t = thread_current();
     void *kpage = NULL;
     struct fte *e = NULL;
 
     // Synchronize access
     lock_acquire(&frame_lock);
 
+    sample_working_set(t);
+    if (t->rss_limit != 0 && t->rss_pages >= t->rss_limit) {
+        if (!may_evict) {
+            lock_release(&frame_lock);
+            return NULL;
+        }
+        if (!evict_local(t))
+            local_fail_cnt++;
+    }
+
     // Allocate a kernel page
-    kpage = try_page_allocation(flags);
+    kpage = may_evict ? try_page_allocation(flags) : palloc_get_page(flags);
     if (kpage == NULL) {
         lock_release(&frame_lock);
         return NULL;  // Allocation failed even after eviction
@@ -48,6 +181,8 @@ falloc_get_page(enum palloc_flags flags, void *upage) {
         return NULL;
     }
     list_push_back(&frame_table, &e->elem);
+    t->rss_pages++;
+    check_watermark();
 
     lock_release(&frame_lock);
     return kpage;
@@ -58,41 +193,207 @@ void *
 try_page_allocation(enum palloc_flags flags) {
     void *kpage = palloc_get_page(flags);
     if (kpage == NULL) {
-        evict_page();  // Evict a page if allocation fails
-        kpage = palloc_get_page(flags);
+        direct_reclaim_cnt++;
+        if (evict_page()
+            || (!list_empty (&huge_frames)
+                && split_huge_frame (list_entry (list_front (&huge_frames),
+                                                 struct huge_frame, elem))
+                && evict_page()))
+            kpage = palloc_get_page(flags);  // Retry after evicting a page
+        else if (oom_kill())
+            kpage = palloc_get_page(flags);  // Retry after killing a process
     }
     return kpage;
 }
 
+/* Wakes the page-out daemon if free user frames are below the
+   low watermark.  Caller must hold frame_lock. */
+static void
+check_watermark (void)
+{
+    if (!kswapd_running || kswapd_awake
+        || palloc_user_free_cnt () >= low_wmark)
+      return;
+    wmark_hit_cnt++;
+    kswapd_awake = true;
+    sema_up (&kswapd_sema);
+}
+
+/* Page-out daemon: evicts pages ahead of demand, so that page
+   faults find a free frame and do not have to evict one
+   themselves.  frame_lock is released after every page, so
+   faulting threads wait for at most one eviction. */
+static void
+kswapd (void *aux UNUSED)
+{
+    for (;;)
+      {
+        int64_t start;
+
+        sema_down (&kswapd_sema);
+        start = timer_ticks ();
+
+        /* Huge pages cannot be evicted whole.  Split the oldest,
+           so the clock can choose among its pages too. */
+        lock_acquire (&frame_lock);
+        if (!list_empty (&huge_frames))
+          split_huge_frame (list_entry (list_front (&huge_frames),
+                                        struct huge_frame, elem));
+        lock_release (&frame_lock);
+
+        while (palloc_user_free_cnt () < high_wmark && swap_free_cnt () > 0)
+          {
+            bool evicted;
+
+            lock_acquire (&frame_lock);
+            evicted = evict_page ();
+            lock_release (&frame_lock);
+            if (!evicted)
+              break;
+            kswapd_evict_cnt++;
+          }
+        kswapd_ticks += timer_ticks () - start;
+
+        lock_acquire (&frame_lock);
+        kswapd_awake = false;
+        lock_release (&frame_lock);
+      }
+}
+
 /* Creates a frame table entry */
 struct fte *
 create_frame_entry(void *kpage, void *upage) {
+    return new_frame_entry(kpage, thread_current(), upage);
+}
+
+/* Creates a frame table entry for KPAGE, mapped by T at UPAGE. */
+static struct fte *
+new_frame_entry(void *kpage, struct thread *t, void *upage) {
     struct fte *entry = (struct fte *) malloc(sizeof(struct fte));
     if (entry == NULL) {
         return NULL;  // Allocation failed
     }
     entry->kernel_page = kpage;
-    entry->user_page = upage;
-    entry->t = thread_current();
+    rmap_init(&entry->rmap, t, upage);
+    entry->cached = false;
+    entry->pin_cnt = 1;
     return entry;
 }
 
-/* Frees a page */
+/* Drops the pin on KPAGE that falloc_get_page() returned it with,
+   making it evictable unless something else pinned it.  Call once
+   the page is mapped and its spte points to it. */
 void
-falloc_free_page (void *kpage)
+falloc_unpin (void *kpage)
+{
+  struct fte *e;
+
+  lock_acquire (&frame_lock);
+  e = get_fte (kpage);
+  ASSERT (e != NULL && e->pin_cnt > 0);
+  e->pin_cnt--;
+  lock_release (&frame_lock);
+}
+
+/* Pins the frame T maps at UPAGE, so that it stays resident until
+   frame_unpin(), if T's page table maps it, writable if WRITE.
+   The shared zero frame is never evicted and needs no pin.
+   Returns false if the page must be faulted in, made writable or
+   split from a huge page first. */
+bool
+frame_pin (struct thread *t, void *upage, bool write)
+{
+  struct spte *s;
+  struct fte *e = NULL;
+  bool pinned = false;
+
+  lock_acquire (&frame_lock);
+  s = get_spte (&t->spt, upage);
+  if (s != NULL && pagedir_get_page (t->pagedir, upage) != NULL
+      && (!write || pagedir_is_writable (t->pagedir, upage)))
+    {
+      if (s->status == ZERO_PAGE && s->kpage == zero_frame)
+        pinned = !write;
+      else if (s->status == FRAME_PAGE)
+        e = get_fte (s->kpage);
+    }
+  if (e != NULL)
+    {
+      e->pin_cnt++;
+      pinned = true;
+    }
+  lock_release (&frame_lock);
+  return pinned;
+}
+
+/* Releases a pin taken by frame_pin() on the frame T maps at
+   UPAGE. */
+void
+frame_unpin (struct thread *t, void *upage)
 {
+  struct spte *s;
   struct fte *e;
+
   lock_acquire (&frame_lock);
+  s = get_spte (&t->spt, upage);
+  if (s != NULL && s->status == FRAME_PAGE)
+    {
+      e = get_fte (s->kpage);
+      ASSERT (e != NULL && e->pin_cnt > 0);
+      e->pin_cnt--;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Drops the current thread's mapping of a page, freeing the
+   frame once no other thread maps it. */
+void
+falloc_free_page (void *kpage)
+{
+  lock_acquire (&frame_lock);
+  falloc_free_page_locked (kpage);
+  lock_release (&frame_lock);
+}
+
+/* Like falloc_free_page(), for a caller that holds frame_lock. */
+void
+falloc_free_page_locked (void *kpage)
+{
+  struct fte *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
 
   // find fte
   e = get_fte (kpage);
   if (e == NULL) PANIC ("Failed to free page. No such page found");
   
   // free it
+  unmap_frame_entry (e, thread_current ());
+}
+
+/* Removes T's mapping of E, freeing the frame if nobody else
+   maps it.  Caller must hold frame_lock. */
+static void
+unmap_frame_entry (struct fte *e, struct thread *t)
+{
+  t->rss_pages--;
+  if (!rmap_remove (&e->rmap, t))
+    free_frame_entry (e);
+}
+
+/* Frees E, which no page table maps any more, and its frame.
+   Caller must hold frame_lock. */
+static void
+free_frame_entry (struct fte *e)
+{
+  if (clock_ptr == e)
+    clock_ptr = clock_next (e);
+  if (e->cached)
+    hash_delete (&text_cache, &e->cache_elem);
   list_remove (&e->elem);
-  palloc_free_page (e);
-  pagedir_clear_page (e->t->pagedir, e->user_page);
-  lock_release (&frame_lock);
+  rmap_destroy (&e->rmap);
+  palloc_free_page (e->kernel_page);
+  free (e);
 }
 
 struct fte *
@@ -105,34 +406,664 @@ get_fte (void* kpage)
   return NULL;
 }
 
-/* Evict Page */
-void
+/* Returns the frame after E in clock order, or a null pointer
+   if E is the last one. */
+static struct fte *
+clock_next (struct fte *e)
+{
+  struct list_elem *next = list_next (&e->elem);
+  return next != list_end (&frame_table) ? list_entry (next, struct fte, elem) : NULL;
+}
+
+/* Returns the spte of the first mapping of E.  All of E's
+   mappings map the same part of the same file, if any. */
+static struct spte *
+first_spte (struct fte *e)
+{
+  return get_spte (&e->rmap.first.t->spt, e->rmap.first.upage);
+}
+
+/* Returns true if evicting E would write it to swap: it is an
+   anonymous page, or a file page written through some mapping
+   since it was read. */
+static bool
+needs_swap (struct fte *e)
+{
+  struct spte *s = first_spte (e);
+  return s->file == NULL || (s->writable && rmap_is_dirty (&e->rmap));
+}
+
+/* How a frame is being evicted, for evict_mapping(). */
+struct eviction
+  {
+    enum spt_status status;     /* SWAP_PAGE or FILE_PAGE. */
+    int swap_id;                /* Slot holding the page, or -1. */
+    bool first;                 /* Next mapping is the first? */
+  };
+
+/* Points one mapping's spte at where its evicted page went.
+   Each mapping holds its own reference to the swap slot. */
+static void
+evict_mapping (struct rmap_entry *m, void *ev_)
+{
+  struct eviction *ev = ev_;
+  struct spte *s = get_spte (&m->t->spt, m->upage);
+
+  if (ev->swap_id != -1)
+    {
+      if (!ev->first)
+        swap_dup (ev->swap_id);
+      m->t->swap_pages++;
+    }
+  ev->first = false;
+  m->t->rss_pages--;
+  s->swap_id = ev->swap_id;
+  s->status = ev->status;
+  s->kpage = NULL;
+}
+
+/* Evict Page: second-chance clock over the frame table, looking
+   at the accessed bits of every mapping of each frame.  Pinned
+   frames, still being filled or in use by a system call, are
+   skipped, and so are pages that need swap once it is full.
+   Returns false if there is no frame to evict. */
+bool
 evict_page()
 {
-  struct fte *e = clock_ptr;
-  
+  struct fte *e;
+  size_t budget = 2 * list_size (&frame_table);
+  bool swap_full = swap_free_cnt () == 0;
+
   while(true) {
-    if (e!=NULL) {
-      pagedir_set_accessed(e->t->pagedir, e->user_page, false);
-    }
-    if (clock_ptr == NULL || list_next(&clock_ptr->elem) == list_end(&frame_table)) {
-      e = list_entry(list_begin(&frame_table), struct fte, elem);
-    } else {
-      e = list_next(&e->elem);
-    }
+    if (budget-- == 0)
+      return false;
+    if (clock_ptr == NULL)
+      clock_ptr = list_entry(list_begin(&frame_table), struct fte, elem);
+    e = clock_ptr;
+    clock_ptr = clock_next (e);
 
-    if (pagedir_is_accessed(e->t->pagedir, e->user_page)) {
+    if (e->pin_cnt > 0)
+      continue;
+    if (swap_full && needs_swap (e))
+      continue;
+    if (!rmap_test_and_clear_accessed (&e->rmap)) {
       break;
     }
   }
 
-  struct spte *s = get_spte(&thread_current()->spt, e->user_page);
-  s->status = SWAP_PAGE;
-  s->swap_id = swap_out(e->kernel_page);
+  evict_frame (e);
+  return true;
+}
+
+/* Evicts E.  It is unmapped everywhere and written to swap once,
+   and all of its mappers share the swap slot.  File pages that no
+   mapping has written, read-only ones included, are not written
+   at all.  Caller must hold frame_lock. */
+static void
+evict_frame (struct fte *e)
+{
+  struct spte *s;
+  struct eviction ev;
+  bool dirty;
+
+  /* Unmap first, so no mapper can modify the page while it is
+     being written out. */
+  dirty = rmap_unmap_all(&e->rmap);
+  s = first_spte(e);
+
+  /* Clean file pages match the file: drop them, and read them
+     from the file again on the next fault. */
+  if (s->file != NULL && (!s->writable || !dirty)) {
+    ev.swap_id = -1;
+    ev.status = FILE_PAGE;
+    if (s->writable)
+      clean_dropped_cnt++;
+    else
+      text_dropped_cnt++;
+  } else {
+    ev.swap_id = swap_out(e->kernel_page);
+    ev.status = SWAP_PAGE;
+  }
+  ev.first = true;
+  rmap_foreach(&e->rmap, evict_mapping, &ev);
+
+  free_frame_entry (e);
+}
+
+/* Returns the frame table entry that R belongs to. */
+static struct fte *
+rmap_fte (struct rmap *r)
+{
+  return (struct fte *) ((uint8_t *) r - offsetof (struct fte, rmap));
+}
+
+/* Evicts one of T's pages, for a process at its resident set
+   limit: second chance over T's frame_maps, moving each mapping
+   looked at to the back.  Frames T shares with other processes
+   are left to the global clock.  Caller must hold frame_lock.
+   Returns false if T has no page to evict. */
+static bool
+evict_local (struct thread *t)
+{
+  size_t budget = 2 * list_size (&t->frame_maps);
+  bool swap_full = swap_free_cnt () == 0;
+
+  while (budget-- > 0)
+    {
+      struct rmap_entry *m = list_entry (list_pop_front (&t->frame_maps),
+                                         struct rmap_entry, thread_elem);
+      struct fte *e = rmap_fte (m->rmap);
+
+      list_push_back (&t->frame_maps, &m->thread_elem);
+      if (e->pin_cnt > 0 || rmap_is_shared (&e->rmap)
+          || (swap_full && needs_swap (e)))
+        continue;
+      if (!rmap_test_and_clear_accessed (&e->rmap))
+        {
+          evict_frame (e);
+          local_evict_cnt++;
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Counts the pages T touched since the last sample, clearing
+   their accessed bits, if WSS_SAMPLE_TICKS have passed since.
+   Caller must hold frame_lock. */
+static void
+sample_working_set (struct thread *t)
+{
+  struct list_elem *l;
+  size_t cnt = 0;
+
+  if (timer_elapsed (t->wss_stamp) < WSS_SAMPLE_TICKS)
+    return;
+  for (l = list_begin (&t->frame_maps); l != list_end (&t->frame_maps);
+       l = list_next (l))
+    {
+      struct rmap_entry *m = list_entry (l, struct rmap_entry, thread_elem);
+      if (pagedir_is_accessed (t->pagedir, m->upage))
+        {
+          pagedir_set_accessed (t->pagedir, m->upage, false);
+          cnt++;
+        }
+    }
+  t->wss_pages = cnt;
+  t->wss_stamp = timer_ticks ();
+  wss_sample_cnt++;
+  if (t->rss_limit != 0 && cnt >= t->rss_limit)
+    wss_over_cnt++;
+}
 
-  lock_release(&frame_lock);
-  falloc_free_page(e->kernel_page);
-  lock_acquire(&frame_lock);
+/* Evicts T's pages until it is within its resident set limit, or
+   it has nothing more to evict.  Used when the limit is lowered. */
+void
+frame_trim_rss (struct thread *t)
+{
+  lock_acquire (&frame_lock);
+  while (t->rss_limit != 0 && t->rss_pages > t->rss_limit && evict_local (t))
+    continue;
+  lock_release (&frame_lock);
+}
 
-  return;
-}
\ No newline at end of file
+void
+frame_lock_acquire (void)
+{
+  lock_acquire (&frame_lock);
+}
+
+void
+frame_lock_release (void)
+{
+  lock_release (&frame_lock);
+}
+
+/* Records that T maps KPAGE at UPAGE besides the frame's owner.
+   Used by fork(); the caller maps the page read-only in both
+   page tables.  Caller must hold frame_lock.  Returns false if
+   out of memory. */
+bool
+frame_share (void *kpage, struct thread *t, void *upage)
+{
+  struct fte *e = get_fte (kpage);
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (e != NULL);
+  return add_share (e, t, upage);
+}
+
+/* Adds T's mapping of E at UPAGE to E's reverse map. */
+static bool
+add_share (struct fte *e, struct thread *t, void *upage)
+{
+  if (!rmap_add (&e->rmap, t, upage))
+    return false;
+  t->rss_pages++;
+  return true;
+}
+
+/* Handles a write fault on the current thread's copy-on-write
+   page S.  If other threads still map the frame, the page is
+   copied into a new frame and the thread's mapping moved there;
+   the last mapper just gets write access back.  Returns false if
+   no frame could be allocated. */
+bool
+frame_cow (struct spte *s)
+{
+  struct thread *t = thread_current ();
+  struct fte *e, *copy;
+  void *kpage;
+
+  lock_acquire (&frame_lock);
+  cow_fault_cnt++;
+
+  /* Evicted since the fault: the retried access will page it
+     back in, writable. */
+  if (s->status != FRAME_PAGE)
+    {
+      lock_release (&frame_lock);
+      return true;
+    }
+
+  e = get_fte (s->kpage);
+  ASSERT (e != NULL);
+  if (!rmap_is_shared (&e->rmap))
+    {
+      pagedir_set_writable (t->pagedir, s->upage, true);
+      lock_release (&frame_lock);
+      return true;
+    }
+
+  kpage = try_page_allocation (PAL_USER);
+  if (kpage == NULL)
+    {
+      lock_release (&frame_lock);
+      return false;
+    }
+  check_watermark ();
+
+  /* Making room may have evicted the shared frame itself. */
+  if (s->status != FRAME_PAGE)
+    {
+      palloc_free_page (kpage);
+      lock_release (&frame_lock);
+      return true;
+    }
+  e = get_fte (s->kpage);
+
+  copy = create_frame_entry (kpage, s->upage);
+  if (copy == NULL)
+    {
+      palloc_free_page (kpage);
+      lock_release (&frame_lock);
+      return false;
+    }
+  memcpy (kpage, s->kpage, PGSIZE);
+  copy->pin_cnt = 0;
+
+  unmap_frame_entry (e, t);
+  list_push_back (&frame_table, &copy->elem);
+  t->rss_pages++;
+  if (!pagedir_set_page (t->pagedir, s->upage, kpage, true))
+    PANIC ("copy-on-write: page table vanished");
+
+  /* The copy may hold changes the new PTE knows nothing about. */
+  pagedir_set_dirty (t->pagedir, s->upage, true);
+  s->kpage = kpage;
+  cow_copy_cnt++;
+
+  lock_release (&frame_lock);
+  return true;
+}
+
+/* Maps the read-only file page described by S into the current
+   thread from the text cache, if another process already has it
+   in memory.  Returns true if S is now mapped. */
+bool
+frame_map_cached (struct spte *s)
+{
+  struct thread *t = thread_current ();
+  struct fte key, *e;
+  struct hash_elem *h;
+  bool mapped = false;
+
+  ASSERT (s->status == FILE_PAGE && !s->writable);
+  key.inode = file_get_inode (s->file);
+  key.file_ofs = s->file_offset;
+  key.read_bytes = s->read_bytes;
+
+  lock_acquire (&frame_lock);
+  h = hash_find (&text_cache, &key.cache_elem);
+  if (h != NULL)
+    {
+      e = hash_entry (h, struct fte, cache_elem);
+      if (pagedir_set_page (t->pagedir, s->upage, e->kernel_page, false))
+        {
+          if (add_share (e, t, s->upage))
+            {
+              s->kpage = e->kernel_page;
+              s->status = FRAME_PAGE;
+              text_shared_cnt++;
+              mapped = true;
+            }
+          else
+            pagedir_clear_page (t->pagedir, s->upage);
+        }
+    }
+  lock_release (&frame_lock);
+  return mapped;
+}
+
+/* Adds KPAGE, which the current thread just loaded from the
+   read-only file page S, to the text cache.  If another process
+   raced us and cached the same page, KPAGE stays private. */
+void
+frame_cache_page (void *kpage, struct spte *s)
+{
+  struct fte *e;
+
+  lock_acquire (&frame_lock);
+  e = get_fte (kpage);
+  if (e == NULL || e->cached)
+    {
+      lock_release (&frame_lock);
+      return;
+    }
+  e->inode = file_get_inode (s->file);
+  e->file_ofs = s->file_offset;
+  e->read_bytes = s->read_bytes;
+  if (hash_insert (&text_cache, &e->cache_elem) == NULL)
+    {
+      e->cached = true;
+      text_cached_cnt++;
+    }
+  lock_release (&frame_lock);
+}
+
+static unsigned
+text_hash (const struct hash_elem *e_, void *aux UNUSED)
+{
+  const struct fte *e = hash_entry (e_, struct fte, cache_elem);
+  return hash_bytes (&e->inode, sizeof e->inode) ^ hash_int (e->file_ofs);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct fte *a = hash_entry (a_, struct fte, cache_elem);
+  const struct fte *b = hash_entry (b_, struct fte, cache_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->file_ofs != b->file_ofs)
+    return a->file_ofs < b->file_ofs;
+  return a->read_bytes < b->read_bytes;
+}
+
+/* Allocates HUGE_PAGE_PAGES physically contiguous user frames,
+   4 MB aligned and zeroed if ZERO, for a huge page.  Never
+   evicts, leaves the page-out daemon's high watermark free, and
+   keeps the current process within its resident set limit.
+   Returns a null pointer on failure. */
+void *
+falloc_get_huge (bool zero)
+{
+  struct thread *t = thread_current ();
+  void *kpage = NULL;
+
+  lock_acquire (&frame_lock);
+  if (palloc_user_free_cnt () >= HUGE_PAGE_PAGES + high_wmark
+      && (t->rss_limit == 0 || t->rss_pages + HUGE_PAGE_PAGES <= t->rss_limit))
+    kpage = palloc_get_aligned (PAL_USER, HUGE_PAGE_PAGES, HUGE_PAGE_PAGES);
+  if (kpage == NULL)
+    huge_fail_cnt++;
+  lock_release (&frame_lock);
+
+  if (kpage != NULL && zero)
+    memset (kpage, 0, HUGE_PAGE_SIZE);
+  return kpage;
+}
+
+/* Frees frames from falloc_get_huge() that were never installed. */
+void
+falloc_free_huge (void *kpage)
+{
+  palloc_free_multiple (kpage, HUGE_PAGE_PAGES);
+}
+
+/* Maps the frames at KPAGE, from falloc_get_huge(), as a huge
+   page at UPAGE in the current thread.  The caller has already
+   created the sptes for its pages.  Returns false if out of
+   memory. */
+bool
+frame_install_huge (void *kpage, void *upage, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct huge_frame *hf = malloc (sizeof *hf);
+
+  if (hf == NULL)
+    return false;
+  hf->kernel_page = kpage;
+  hf->user_page = upage;
+  hf->t = t;
+
+  lock_acquire (&frame_lock);
+  pagedir_set_huge_page (t->pagedir, upage, kpage, writable);
+  list_push_back (&huge_frames, &hf->elem);
+  t->rss_pages += HUGE_PAGE_PAGES;
+  huge_map_cnt++;
+  check_watermark ();
+  lock_release (&frame_lock);
+  return true;
+}
+
+/* Returns T's huge page that contains UPAGE, or a null pointer.
+   Caller must hold frame_lock. */
+static struct huge_frame *
+find_huge_frame (struct thread *t, void *upage)
+{
+  struct list_elem *l;
+
+  for (l = list_begin (&huge_frames); l != list_end (&huge_frames);
+       l = list_next (l))
+    {
+      struct huge_frame *hf = list_entry (l, struct huge_frame, elem);
+      if (hf->t == t && (uint8_t *) hf->user_page <= (uint8_t *) upage
+          && (uint8_t *) upage < (uint8_t *) hf->user_page + HUGE_PAGE_SIZE)
+        return hf;
+    }
+  return NULL;
+}
+
+/* Turns HF into HUGE_PAGE_PAGES ordinary frames, mapped by 4 kB
+   PTEs and entered in the frame table, and frees HF.  Its sptes
+   already describe each page.  Caller must hold frame_lock.
+   Returns false, leaving HF intact, if out of memory. */
+static bool
+split_huge_frame (struct huge_frame *hf)
+{
+  struct list ftes;
+  size_t i;
+
+  list_init (&ftes);
+  for (i = 0; i < HUGE_PAGE_PAGES; i++)
+    {
+      struct fte *e = new_frame_entry ((uint8_t *) hf->kernel_page + i * PGSIZE,
+                                       hf->t, (uint8_t *) hf->user_page + i * PGSIZE);
+      if (e == NULL)
+        break;
+      e->pin_cnt = 0;
+      list_push_back (&ftes, &e->elem);
+    }
+
+  if (i < HUGE_PAGE_PAGES
+      || !pagedir_split_huge_page (hf->t->pagedir, hf->user_page))
+    {
+      while (!list_empty (&ftes))
+        {
+          struct fte *e = list_entry (list_pop_front (&ftes), struct fte, elem);
+          rmap_destroy (&e->rmap);
+          free (e);
+        }
+      return false;
+    }
+
+  while (!list_empty (&ftes))
+    list_push_back (&frame_table, list_pop_front (&ftes));
+  list_remove (&hf->elem);
+  free (hf);
+  huge_split_cnt++;
+  return true;
+}
+
+/* Splits T's huge page containing UPAGE, if there is one, so that
+   UPAGE can be changed on its own.  Returns false if out of
+   memory. */
+bool
+frame_split_huge (struct thread *t, void *upage)
+{
+  struct huge_frame *hf;
+  bool success;
+
+  if (!pagedir_is_huge_page (t->pagedir, upage))
+    return true;
+  lock_acquire (&frame_lock);
+  hf = find_huge_frame (t, upage);
+  success = hf == NULL || split_huge_frame (hf);
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Splits all of T's huge pages, so that fork() can share their
+   frames copy-on-write.  Returns false if out of memory. */
+bool
+frame_split_huge_all (struct thread *t)
+{
+  struct list_elem *l, *next;
+  bool success = true;
+
+  lock_acquire (&frame_lock);
+  for (l = list_begin (&huge_frames); success && l != list_end (&huge_frames);
+       l = next)
+    {
+      struct huge_frame *hf = list_entry (l, struct huge_frame, elem);
+      next = list_next (l);
+      if (hf->t == t)
+        success = split_huge_frame (hf);
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Unmaps and frees all of T's huge pages along with their sptes,
+   when T exits. */
+void
+frame_free_huge (struct thread *t)
+{
+  struct list_elem *l, *next;
+
+  lock_acquire (&frame_lock);
+  for (l = list_begin (&huge_frames); l != list_end (&huge_frames); l = next)
+    {
+      struct huge_frame *hf = list_entry (l, struct huge_frame, elem);
+      size_t i;
+
+      next = list_next (l);
+      if (hf->t != t)
+        continue;
+      for (i = 0; i < HUGE_PAGE_PAGES; i++)
+        {
+          struct spte *s = get_spte (&t->spt, (uint8_t *) hf->user_page + i * PGSIZE);
+          if (s != NULL)
+            {
+              hash_delete (&t->spt, &s->hash_elem);
+              free (s);
+            }
+        }
+      pagedir_clear_huge_page (t->pagedir, hf->user_page);
+      palloc_free_multiple (hf->kernel_page, HUGE_PAGE_PAGES);
+      t->rss_pages -= HUGE_PAGE_PAGES;
+      list_remove (&hf->elem);
+      free (hf);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Takes back every frame T maps, for the OOM killer: frames only
+   T maps are freed, shared ones are left to their other mappers.
+   T's sptes for them become zero pages, which is harmless because
+   T is about to die.  Pinned frames, still being filled or in use
+   by a system call, are left alone, and so are dirty pages of
+   writable files, which T's exit must still write back to a
+   mapped file.  Caller must hold frame_lock.  Returns the number
+   of frames freed. */
+size_t
+frame_reclaim (struct thread *t)
+{
+  struct list_elem *l, *next;
+  size_t freed = 0;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  for (l = list_begin (&huge_frames); l != list_end (&huge_frames); l = next)
+    {
+      struct huge_frame *hf = list_entry (l, struct huge_frame, elem);
+      next = list_next (l);
+      if (hf->t == t)
+        split_huge_frame (hf);
+    }
+
+  for (l = list_begin (&frame_table); l != list_end (&frame_table); l = next)
+    {
+      struct fte *e = list_entry (l, struct fte, elem);
+      void *upage;
+      struct spte *s;
+
+      next = list_next (l);
+      if (e->pin_cnt > 0)
+        continue;
+      upage = rmap_lookup (&e->rmap, t);
+      if (upage == NULL)
+        continue;
+
+      s = get_spte (&t->spt, upage);
+      if (s != NULL && s->file != NULL && s->writable
+          && rmap_is_dirty (&e->rmap))
+        continue;
+      if (s != NULL)
+        {
+          s->status = ZERO_PAGE;
+          s->kpage = NULL;
+        }
+      if (!rmap_is_shared (&e->rmap))
+        freed++;
+      unmap_frame_entry (e, t);
+    }
+  return freed;
+}
+
+/* Prints copy-on-write, text cache, page-out, resident set limit
+   and huge page statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Copy-on-write: %zu faults, %zu pages copied\n",
+          cow_fault_cnt, cow_copy_cnt);
+  printf ("Text cache: %zu pages cached, %zu faults shared, "
+          "%zu pages dropped\n",
+          text_cached_cnt, text_shared_cnt, text_dropped_cnt);
+  printf ("Clean file pages: %zu dropped on eviction instead of swapped\n",
+          clean_dropped_cnt);
+  printf ("Page-out daemon: %zu low watermark hits, %zu pages evicted, "
+          "%"PRId64" ticks; %zu direct reclaim stalls\n",
+          wmark_hit_cnt, kswapd_evict_cnt, kswapd_ticks, direct_reclaim_cnt);
+  printf ("RSS limits: %zu pages evicted locally, %zu times nothing to evict; "
+          "%zu working set samples, %zu at the limit\n",
+          local_evict_cnt, local_fail_cnt, wss_sample_cnt, wss_over_cnt);
+  printf ("Huge pages: %zu mapped, saving %zu faults and TLB entries; "
+          "%zu split, %zu fell back to 4 kB pages\n",
+          huge_map_cnt, huge_map_cnt * (HUGE_PAGE_PAGES - 1),
+          huge_split_cnt, huge_fail_cnt);
+}
@@ -1,31 +1,98 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+#include <hash.h>
 #include <list.h>
+#include "filesys/off_t.h"
 #include "threads/palloc.h"
 #include "userprog/pagedir.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
+#include "vm/rmap.h"
 
 
+struct spte;
+struct inode;
+
 /* Frame Table Entry*/
 struct fte
 {
     void *kernel_page;
     struct list_elem elem;
 
-    void *user_page;
+    struct rmap rmap;       /* Every (thread, user page) mapping it. */
+    unsigned pin_cnt;       /* Pins held; a pinned frame is not evicted. */
+
+    /* Read-only file page in the text cache, if CACHED. */
+    bool cached;
+    struct hash_elem cache_elem;
+    struct inode *inode;
+    off_t file_ofs;
+    uint32_t read_bytes;
+};
+
+/* A 4 MB user mapping backed by HUGE_PAGE_PAGES physically
+   contiguous frames and a single PDE.  Its frames are not in the
+   frame table: under memory pressure, and before any of its 4 kB
+   pages is changed on its own, it is split into ordinary frames. */
+struct huge_frame
+{
+    void *kernel_page;
+    void *user_page;        /* 4 MB aligned. */
     struct thread *t;
+    struct list_elem elem;
 };
 
+#define HUGE_PAGE_PAGES 1024                    /* 4 kB pages per huge page. */
+#define HUGE_PAGE_SIZE (HUGE_PAGE_PAGES * PGSIZE)
+
+/* Map large anonymous and mmap regions with huge pages?  Set with
+   "-hugepages"; ignored if the CPU lacks 4 MB pages. */
+extern bool huge_pages_enabled;
+
+/* Resident set limit, in frames, of processes started by the
+   kernel, or 0 for none.  Set with "-rss=COUNT". */
+extern size_t rss_limit_default;
+
+/* Free user frame watermarks for the page-out daemon, as
+   divisors of the user pool size: it wakes when fewer than
+   pool/LOW frames are free and evicts until pool/HIGH are. */
+#define FRAME_LOW_WMARK_DIV 64
+#define FRAME_HIGH_WMARK_DIV 32
+
+/* Read-only frame of zeros shared by all untouched zero pages.
+   It is not in the frame table and is never evicted. */
+extern void *zero_frame;
+
 /* Frame Table functions*/
 void frame_init (void);
+void frame_start_kswapd (void);
 void *falloc_get_page(enum palloc_flags flags, void *upage);
+void *falloc_get_free_page(enum palloc_flags flags, void *upage);
 void  falloc_free_page (void *);
+void  falloc_free_page_locked (void *);
+void  falloc_unpin (void *);
+bool frame_pin (struct thread *, void *upage, bool write);
+void frame_unpin (struct thread *, void *upage);
 void *try_page_allocation(enum palloc_flags flags);
 struct fte *create_frame_entry(void *kpage, void *upage);
-void evict_page(void);
+bool evict_page(void);
 struct fte *get_fte (void* );
+void frame_lock_acquire (void);
+void frame_lock_release (void);
+bool frame_share (void *kpage, struct thread *t, void *upage);
+bool frame_cow (struct spte *);
+bool frame_map_cached (struct spte *);
+void frame_cache_page (void *kpage, struct spte *);
+void *falloc_get_huge (bool zero);
+void  falloc_free_huge (void *kpage);
+bool frame_install_huge (void *kpage, void *upage, bool writable);
+bool frame_split_huge (struct thread *, void *upage);
+bool frame_split_huge_all (struct thread *);
+void frame_free_huge (struct thread *);
+size_t frame_reclaim (struct thread *);
+void frame_trim_rss (struct thread *);
+void frame_print_stats (void);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "vm/oom.h"
+#include <debug.h>
+#include <stdio.h>
+#include <syscall-nr.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+#include "vm/spt.h"
+#include "vm/swap.h"
+
+/* Out-of-memory killer.
+
+   When a frame is needed and eviction cannot supply one, because
+   every frame is pinned or swap is full, the process with the
+   highest badness is killed and its memory reclaimed on the
+   spot, and the allocation is retried.  Without this, whichever
+   process happened to fault would die instead.
+
+   A process's badness is the number of pages it holds, resident
+   or swapped, plus its oom_adjust() bias scaled to the total
+   number of frames and swap slots: a bias of OOM_ADJ_MAX adds
+   all of memory, and OOM_ADJ_MIN exempts the process.
+
+   The victim is marked and dies the next time it faults in user
+   mode or passes through a system call.  Its frames and swap
+   slots are freed at once, so the killer need not wait for it to
+   be scheduled, except for dirty pages of files, which are left
+   for its exit to write back to mapped files.  This is safe while
+   the victim runs because every process changes its supplemental
+   page table, and takes pages out of swap, only under the frame
+   lock that the killer holds. */
+
+/* Statistics. */
+static size_t oom_kill_cnt;       /* Processes killed. */
+static size_t oom_frame_cnt;      /* Frames reclaimed from them. */
+static size_t oom_swap_cnt;       /* Swap slots reclaimed from them. */
+
+/* Victim search state, for thread_foreach(). */
+struct oom_search
+  {
+    size_t total;               /* Frames plus swap slots. */
+    struct thread *victim;      /* Worst process so far. */
+    long badness;               /* Its badness. */
+  };
+
+/* Returns T's badness, given TOTAL frames and swap slots. */
+static long
+badness (const struct thread *t, size_t total)
+{
+  return ((long) (t->rss_pages + t->swap_pages)
+          + (long) t->oom_adj * (long) total / OOM_ADJ_MAX);
+}
+
+/* thread_foreach() callback: considers T as the victim. */
+static void
+consider (struct thread *t, void *search_)
+{
+  struct oom_search *search = search_;
+  long score;
+
+  if (t->pagedir == NULL || t->oom_killed || t->oom_adj <= OOM_ADJ_MIN
+      || t->status == THREAD_DYING || t->rss_pages + t->swap_pages == 0)
+    return;
+  score = badness (t, search->total);
+  if (search->victim == NULL || score > search->badness)
+    {
+      search->victim = t;
+      search->badness = score;
+    }
+}
+
+/* Kills the process with the highest badness and reclaims its
+   frames and swap slots, moving on to the next worst while the
+   victims' frames are all shared with other processes.  Caller
+   must hold the frame lock.  Returns true if any frame was freed,
+   so that the caller's allocation is worth retrying. */
+bool
+oom_kill (void)
+{
+  for (;;)
+    {
+      struct oom_search search;
+      struct thread *t;
+      enum intr_level old_level;
+      size_t frames, slots;
+
+      search.total = palloc_user_page_cnt () + swap_slot_cnt ();
+      search.victim = NULL;
+      search.badness = 0;
+      old_level = intr_disable ();
+      thread_foreach (consider, &search);
+      intr_set_level (old_level);
+
+      t = search.victim;
+      if (t == NULL)
+        {
+          printf ("OOM: no process to kill; %zu frames and %zu swap slots "
+                  "free\n", palloc_user_free_cnt (), swap_free_cnt ());
+          return false;
+        }
+
+      printf ("OOM: killing %s (tid %d): badness %ld from %zu resident and "
+              "%zu swapped pages, adj %d; %zu frames and %zu swap slots "
+              "free\n", t->name, t->tid, search.badness, t->rss_pages,
+              t->swap_pages, t->oom_adj, palloc_user_free_cnt (),
+              swap_free_cnt ());
+      t->oom_killed = true;
+      frames = frame_reclaim (t);
+      slots = spt_reclaim_swap (t);
+      printf ("OOM: reclaimed %zu frames and %zu swap slots from %s\n",
+              frames, slots, t->name);
+
+      oom_kill_cnt++;
+      oom_frame_cnt += frames;
+      oom_swap_cnt += slots;
+      if (frames > 0)
+        return true;
+    }
+}
+
+/* Prints OOM killer statistics. */
+void
+oom_print_stats (void)
+{
+  printf ("OOM killer: %zu processes killed, %zu frames and %zu swap "
+          "slots reclaimed\n", oom_kill_cnt, oom_frame_cnt, oom_swap_cnt);
+}
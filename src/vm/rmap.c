@@ -0,0 +1,241 @@
+#include "vm/rmap.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Reverse mapping.
+
+   Each frame in the frame table has an rmap listing every page
+   table entry that maps it, so that eviction can unmap a frame
+   and collect its accessed and dirty bits from all of its
+   mappers.  Frames shared copy-on-write after fork(), text pages
+   shared through the text cache and any other kind of sharing
+   all go through the same list.
+
+   A page's dirty bit must survive its mapping being removed
+   while other threads still map the frame, or a change made
+   before fork() would be forgotten once the writer takes a
+   private copy, and eviction could drop the frame as clean.
+   rmap_remove() moves it to a remaining mapping.
+
+   Every mapping is also on its thread's frame_maps list, which
+   frame.c turns into that process's own clock when it is held to
+   a resident set limit.
+
+   The caller serializes access, by holding frame_lock. */
+
+/* Statistics. */
+static size_t extra_cnt;          /* rmap_entrys now allocated. */
+static size_t extra_peak;         /* Most allocated at once. */
+static size_t dirty_carry_cnt;    /* Dirty bits moved by rmap_remove(). */
+
+/* Initializes R with a single mapping, by T at UPAGE. */
+void
+rmap_init (struct rmap *r, struct thread *t, void *upage)
+{
+  r->first.t = t;
+  r->first.upage = upage;
+  r->first.rmap = r;
+  list_push_back (&t->frame_maps, &r->first.thread_elem);
+  list_init (&r->more);
+}
+
+/* Records that T also maps R's frame at UPAGE.  Returns false if
+   out of memory. */
+bool
+rmap_add (struct rmap *r, struct thread *t, void *upage)
+{
+  struct rmap_entry *m = malloc (sizeof *m);
+
+  if (m == NULL)
+    return false;
+  m->t = t;
+  m->upage = upage;
+  m->rmap = r;
+  list_push_back (&r->more, &m->elem);
+  list_push_back (&t->frame_maps, &m->thread_elem);
+  if (++extra_cnt > extra_peak)
+    extra_peak = extra_cnt;
+  return true;
+}
+
+/* Unmaps R's frame from T's page table and, if other mappings
+   remain, removes T's from R, giving its dirty bit to the first
+   one left.  Returns true if other mappings remain; if not, R
+   still names T's mapping. */
+bool
+rmap_remove (struct rmap *r, struct thread *t)
+{
+  struct rmap_entry *m = NULL;
+  struct list_elem *l;
+  bool dirty;
+
+  if (r->first.t == t)
+    m = &r->first;
+  else
+    for (l = list_begin (&r->more); l != list_end (&r->more); l = list_next (l))
+      if (list_entry (l, struct rmap_entry, elem)->t == t)
+        {
+          m = list_entry (l, struct rmap_entry, elem);
+          break;
+        }
+  ASSERT (m != NULL);
+
+  pagedir_clear_page (t->pagedir, m->upage);
+  if (list_empty (&r->more))
+    return false;
+  dirty = pagedir_is_dirty (t->pagedir, m->upage);
+
+  if (m == &r->first)
+    {
+      /* Move the next mapping into the inline slot, keeping its
+         place in its thread's list. */
+      m = list_entry (list_pop_front (&r->more), struct rmap_entry, elem);
+      list_remove (&r->first.thread_elem);
+      list_insert (&m->thread_elem, &r->first.thread_elem);
+      r->first.t = m->t;
+      r->first.upage = m->upage;
+    }
+  else
+    list_remove (&m->elem);
+  list_remove (&m->thread_elem);
+  free (m);
+  extra_cnt--;
+
+  if (dirty && !pagedir_is_dirty (r->first.t->pagedir, r->first.upage))
+    {
+      pagedir_set_dirty (r->first.t->pagedir, r->first.upage, true);
+      dirty_carry_cnt++;
+    }
+  return true;
+}
+
+/* Forgets all of R's mappings, without touching any page table,
+   and frees its extra ones. */
+void
+rmap_destroy (struct rmap *r)
+{
+  list_remove (&r->first.thread_elem);
+  while (!list_empty (&r->more))
+    {
+      struct rmap_entry *m = list_entry (list_pop_front (&r->more),
+                                         struct rmap_entry, elem);
+      list_remove (&m->thread_elem);
+      free (m);
+      extra_cnt--;
+    }
+}
+
+/* Returns the user page at which T maps R's frame, or a null
+   pointer if T does not map it. */
+void *
+rmap_lookup (struct rmap *r, const struct thread *t)
+{
+  struct list_elem *l;
+
+  if (r->first.t == t)
+    return r->first.upage;
+  for (l = list_begin (&r->more); l != list_end (&r->more); l = list_next (l))
+    {
+      struct rmap_entry *m = list_entry (l, struct rmap_entry, elem);
+      if (m->t == t)
+        return m->upage;
+    }
+  return NULL;
+}
+
+/* Returns true if more than one page table maps R's frame. */
+bool
+rmap_is_shared (struct rmap *r)
+{
+  return !list_empty (&r->more);
+}
+
+/* Calls ACTION for each mapping of R's frame, first mapping
+   first.  ACTION must not add or remove mappings. */
+void
+rmap_foreach (struct rmap *r, rmap_action_func *action, void *aux)
+{
+  struct list_elem *l;
+
+  action (&r->first, aux);
+  for (l = list_begin (&r->more); l != list_end (&r->more); l = list_next (l))
+    action (list_entry (l, struct rmap_entry, elem), aux);
+}
+
+/* rmap_foreach() action for rmap_test_and_clear_accessed(). */
+static void
+test_and_clear_accessed (struct rmap_entry *m, void *accessed_)
+{
+  bool *accessed = accessed_;
+
+  if (pagedir_is_accessed (m->t->pagedir, m->upage))
+    {
+      *accessed = true;
+      pagedir_set_accessed (m->t->pagedir, m->upage, false);
+    }
+}
+
+/* Returns true if any mapping of R's frame was accessed since
+   the last call, clearing the accessed bits. */
+bool
+rmap_test_and_clear_accessed (struct rmap *r)
+{
+  bool accessed = false;
+
+  rmap_foreach (r, test_and_clear_accessed, &accessed);
+  return accessed;
+}
+
+/* Returns true if R's frame was written through any of its
+   mappings since it was last clean. */
+bool
+rmap_is_dirty (struct rmap *r)
+{
+  struct list_elem *l;
+
+  if (pagedir_is_dirty (r->first.t->pagedir, r->first.upage))
+    return true;
+  for (l = list_begin (&r->more); l != list_end (&r->more); l = list_next (l))
+    {
+      struct rmap_entry *m = list_entry (l, struct rmap_entry, elem);
+      if (pagedir_is_dirty (m->t->pagedir, m->upage))
+        return true;
+    }
+  return false;
+}
+
+/* rmap_foreach() action for rmap_unmap_all(). */
+static void
+unmap (struct rmap_entry *m, void *dirty_)
+{
+  bool *dirty = dirty_;
+
+  pagedir_clear_page (m->t->pagedir, m->upage);
+  if (pagedir_is_dirty (m->t->pagedir, m->upage))
+    *dirty = true;
+}
+
+/* Unmaps R's frame from every page table that maps it, keeping
+   the mappings in R.  Returns true if the frame is dirty.  The
+   dirty bits are read after unmapping, so that no mapper can
+   write the frame after they are checked. */
+bool
+rmap_unmap_all (struct rmap *r)
+{
+  bool dirty = false;
+
+  rmap_foreach (r, unmap, &dirty);
+  return dirty;
+}
+
+/* Prints reverse mapping statistics. */
+void
+rmap_print_stats (void)
+{
+  printf ("Reverse map: %zu extra mappings, peak %zu; "
+          "%zu dirty bits carried over\n",
+          extra_cnt, extra_peak, dirty_carry_cnt);
+}
@@ -0,0 +1,46 @@
+#ifndef VM_RMAP_H
+#define VM_RMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct thread;
+
+/* One mapping of a frame: thread T maps it at user page UPAGE. */
+struct rmap_entry
+  {
+    struct thread *t;
+    void *upage;
+    struct rmap *rmap;          /* Reverse map it belongs to. */
+    struct list_elem elem;      /* In RMAP's list of further mappings. */
+    struct list_elem thread_elem; /* In T's frame_maps. */
+  };
+
+/* Reverse map of a frame: every page table entry that maps it.
+   The first mapping is kept inline, so an unshared frame costs
+   no extra memory; each further mapping costs one rmap_entry.
+   Each thread also lists the mappings it owns, for replacement
+   among its own frames. */
+struct rmap
+  {
+    struct rmap_entry first;
+    struct list more;           /* Further mappings. */
+  };
+
+/* Called by rmap_foreach() for each mapping of a frame. */
+typedef void rmap_action_func (struct rmap_entry *, void *aux);
+
+void rmap_init (struct rmap *, struct thread *, void *upage);
+bool rmap_add (struct rmap *, struct thread *, void *upage);
+bool rmap_remove (struct rmap *, struct thread *);
+void rmap_destroy (struct rmap *);
+void *rmap_lookup (struct rmap *, const struct thread *);
+bool rmap_is_shared (struct rmap *);
+void rmap_foreach (struct rmap *, rmap_action_func *, void *aux);
+bool rmap_test_and_clear_accessed (struct rmap *);
+bool rmap_is_dirty (struct rmap *);
+bool rmap_unmap_all (struct rmap *);
+void rmap_print_stats (void);
+
+#endif /* vm/rmap.h */
@@ -1,4 +1,7 @@
+#include <stdio.h>
 #include <string.h>
+#include <syscall-nr.h>
+#include "filesys/inode.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "vm/frame.h"
@@ -11,6 +14,28 @@ extern struct lock file_lock;
 static hash_hash_func spt_hash_func;
 static hash_less_func spt_less_func;
 static void page_destructor(struct hash_elem *elem, void *aux);
+static void spt_insert(struct hash *spt, struct spte *e);
+static void fault_around(struct hash *spt, struct spte *e);
+static struct file *fork_file(struct thread *child, struct thread *parent, struct file *f);
+static bool unshare_zero_page(struct spte *e);
+static struct spte *spte_from_vma(struct hash *spt, void *upage, bool file_only);
+static bool load_spte(struct hash *spt, struct spte *e, bool write);
+static void drop_behind(struct hash *spt, struct vma *vma, uint8_t *upage);
+static bool load_huge_page(struct hash *spt, void *upage);
+static bool fault_in(struct hash *spt, void *upage, bool write);
+static bool pin_page(struct thread *t, uint8_t *upage, bool write);
+
+/* Fault-around window, in pages. */
+size_t fault_around_pages = FAULT_AROUND_DEFAULT;
+
+/* Fault-around statistics. */
+static size_t file_fault_cnt;     /* FILE_PAGE faults. */
+static size_t fault_around_cnt;   /* Pages mapped around them. */
+static size_t drop_behind_cnt;    /* Pages dropped behind sequential faults. */
+
+/* Shared zero page statistics. */
+static size_t zero_map_cnt;       /* Read faults given the zero frame. */
+static size_t zero_unshare_cnt;   /* Writes that replaced it. */
 
 /* Initialize hash table */
 void init_spt(struct hash *spt)
@@ -38,18 +63,41 @@ spt_less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux)
 /* Destroy hash table */
 void destroy_spt(struct hash *spt)
 {
+  frame_free_huge(thread_current());
+  frame_lock_acquire();
   hash_destroy(spt, page_destructor);
+  frame_lock_release();
 }
 
-/* Simple hash action function for hash table destruction */
+/* Simple hash action function for hash table destruction.  Runs
+ *  under frame_lock. */
 static void
 page_destructor(struct hash_elem *elem, void *aux)
 {
   struct spte *e;
   e = hash_entry(elem, struct spte, hash_elem);
+  if (e->status == FRAME_PAGE)
+    falloc_free_page_locked(e->kpage);
+  else if (e->status == SWAP_PAGE)
+    swap_free(e->swap_id);
+  else if (e->kpage == zero_frame)
+    pagedir_clear_page(thread_current()->pagedir, e->upage);
   free(e);
 }
 
+/* Adds E to SPT, the current thread's table.  Eviction and the
+ *  OOM killer look up and change other processes' sptes under
+ *  frame_lock, so a table only changes shape, and a swapped page
+ *  only leaves swap, under frame_lock.
+ */
+static void
+spt_insert(struct hash *spt, struct spte *e)
+{
+  frame_lock_acquire();
+  hash_insert(spt, &e->hash_elem);
+  frame_lock_release();
+}
+
 /* Initialize S-page table entry for frame
  *  usage: setup_stack at userprog/process.c
  */
@@ -66,7 +114,7 @@ void init_frame_spte(struct hash *spt, void *upage, void *kpage)
   e->file = NULL;
   e->writable = true;
 
-  hash_insert(spt, &e->hash_elem);
+  spt_insert(spt, e);
 }
 
 /* Initialize S-page table entry for file
@@ -90,15 +138,16 @@ init_file_spte(struct hash *spt, void *_upage, struct file *_file, off_t _ofs, u
 
   e->status = FILE_PAGE;
 
-  hash_insert(spt, &e->hash_elem);
+  spt_insert(spt, e);
 
   return e;
 }
 
 /* Initialize S-page table entry for zero
- *  usage: page_fault at userprog/exception.c
+ *  usage: page_fault at userprog/exception.c,
+ *         load_segment at userprog/process.c
  */
-void
+struct spte *
 init_zero_spte (struct hash *spt, void *upage)
 {
   struct spte *e;
@@ -110,53 +159,198 @@ init_zero_spte (struct hash *spt, void *upage)
   
   e->file = NULL;
   e->writable = true;
-  hash_insert (spt, &e->hash_elem);
+  spt_insert (spt, e);
+
+  return e;
+}
+
+/* Create the spte for UPAGE from the VMA that contains it, so
+ *  that per-page state only exists for pages that were touched.
+ *  If FILE_ONLY, only pages with file contents get one.  Returns
+ *  a null pointer if there is no such VMA.
+ */
+static struct spte *
+spte_from_vma(struct hash *spt, void *upage, bool file_only)
+{
+  struct vma *vma = vma_find(&thread_current()->vm_map, upage);
+  struct spte *e;
+  uint32_t ofs, read_bytes;
+
+  if (vma == NULL)
+    return NULL;
+  ofs = (uint8_t *) upage - vma->start;
+  if (vma->file != NULL && ofs < vma->file_bytes)
+  {
+    read_bytes = vma->file_bytes - ofs < PGSIZE ? vma->file_bytes - ofs : PGSIZE;
+    return init_file_spte(spt, upage, vma->file, vma->file_ofs + ofs,
+                          read_bytes, PGSIZE - read_bytes, vma->writable);
+  }
+  if (file_only)
+    return NULL;
+  e = init_zero_spte(spt, upage);
+  e->writable = vma->writable;
+  return e;
 }
 
 /* Lazy loading implementation
  *  usage: page_fault at userprog/exception.c
  *
+ *  WRITE is true if the faulting access was a write.  Reads of a
+ *  zero page map the shared zero frame instead of a new frame.
+ *  Returns false if UPAGE is not valid or cannot be loaded; the
+ *  caller then kills the process or takes a uaccess fixup.
+ */
+bool load_page(struct hash *spt, void *upage, bool write)
+{
+  return fault_in(spt, upage, write);
+}
+
+/* Bring in the not-present page UPAGE, creating its spte from its
+ *  VMA if it has none.  Returns false if UPAGE is in no VMA or
+ *  cannot be loaded.
  */
-bool load_page(struct hash *spt, void *upage)
+static bool
+fault_in(struct hash *spt, void *upage, bool write)
 {
   struct spte *e;
-  uint32_t *pagedir;
-  void *kpage;
 
-  struct spte pe;
-  struct hash_elem *elem;
-  pe.upage = upage;
-  elem = hash_find(spt, &pe.hash_elem);
-  if(elem==NULL) {
-    //printf("load_page hash find null");
-    sys_exit(-1);
-  }
-  else {
-    e = hash_entry(elem, struct spte, hash_elem);
-    if (e == NULL) {
-      //printf("load_page hash entry null");
-      sys_exit(-1);
+  e = get_spte(spt, upage);
+  if (e == NULL && huge_pages_enabled && load_huge_page(spt, upage))
+    return true;
+  if (e == NULL)
+    e = spte_from_vma(spt, upage, false);
+  return e != NULL && load_spte(spt, e, write);
+}
+
+/* Fault in and pin every page from START to START + SIZE, so that
+ *  a system call can read them (or write them, if WRITE) without
+ *  faulting, and in particular while it holds file_lock.  A page
+ *  at or above the stack pointer saved at system call entry grows
+ *  the stack, as a fault there would.  Returns false, with
+ *  nothing pinned, if part of the range is not valid user memory.
+ *  usage: system calls in userprog/syscall.c
+ */
+bool pin_user_pages(const void *start, size_t size, bool write)
+{
+  struct thread *t = thread_current();
+  uint8_t *first = pg_round_down(start);
+  const uint8_t *end = (const uint8_t *) start + size;
+  uint8_t *upage;
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *) start || !is_user_vaddr(end - 1))
+    return false;
+  for (upage = first; upage < end; upage += PGSIZE)
+    if (!pin_page(t, upage, write))
+    {
+      unpin_user_pages(first, upage - first);
+      return false;
     }
+  return true;
+}
+
+/* Release the pins pin_user_pages() took on START to START + SIZE. */
+void unpin_user_pages(const void *start, size_t size)
+{
+  struct thread *t = thread_current();
+  const uint8_t *end = (const uint8_t *) start + size;
+  uint8_t *upage;
+
+  for (upage = pg_round_down(start); upage < end; upage += PGSIZE)
+    frame_unpin(t, upage);
+}
+
+/* Pin T's page UPAGE, first loading it, splitting its huge page
+ *  or breaking copy-on-write sharing as a fault on it would.
+ *  Eviction may take the page again before it is pinned, so
+ *  retry until it stays.
+ */
+static bool
+pin_page(struct thread *t, uint8_t *upage, bool write)
+{
+  struct hash *spt = &t->spt;
+
+  while (!frame_pin(t, upage, write))
+  {
+    if (!frame_split_huge(t, upage))
+      return false;
+    if (pagedir_get_page(t->pagedir, upage) != NULL)
+    {
+      /* Present but read-only. */
+      if (!write || !cow_page(spt, upage))
+        return false;
+    }
+    else
+    {
+      if (get_spte(spt, upage) == NULL
+          && upage >= (uint8_t *) PHYS_BASE - MAX_STACK_SIZE
+          && upage + PGSIZE > (uint8_t *) t->esp)
+        vma_grow_stack(&t->vm_map, upage);
+      if (!fault_in(spt, upage, write))
+        return false;
+    }
+  }
+  return true;
+}
+
+/* Bring the page E describes into memory and map it.  Returns
+ *  false if there is no frame for it or it cannot be read.
+ */
+static bool
+load_spte(struct hash *spt, struct spte *e, bool write)
+{
+  struct thread *t = thread_current();
+  uint32_t *pagedir = t->pagedir;
+  void *upage = e->upage;
+  void *kpage;
+  int swap_id = -1;
+
+  if (e->status == ZERO_PAGE && !write) {
+    if (!pagedir_set_page(pagedir, upage, zero_frame, false))
+      return false;
+    e->kpage = zero_frame;
+    zero_map_cnt++;
+    return true;
   }
 
+  /* Read-only file pages may already be in memory for another
+   * process running the same executable. */
+  if (e->status == FILE_PAGE && !e->writable && frame_map_cached(e))
+    return true;
+
   kpage = falloc_get_page(PAL_USER, upage);
   if (kpage == NULL) {
     //printf("load_page kpage null");
-    sys_exit(-1);
+    return false;
   }
 
-  bool was_holding_lock = lock_held_by_current_thread(&file_lock);
-
   switch (e->status)
   {
   case ZERO_PAGE:
     memset(kpage, 0, PGSIZE);
     break;
   case SWAP_PAGE:
-    swap_in(e->swap_id, kpage);
+    /* Take the slot under frame_lock: the OOM killer may have
+     * freed it already if we were chosen, and must not free it
+     * while we read it.  The new frame stays pinned until the
+     * page is mapped, so nothing takes it back before then. */
+    frame_lock_acquire();
+    if (e->status == SWAP_PAGE)
+    {
+      swap_id = e->swap_id;
+      e->status = FRAME_PAGE;
+      e->kpage = kpage;
+      t->swap_pages--;
+    }
+    frame_lock_release();
+    if (swap_id != -1)
+      swap_in(swap_id, kpage);
+    else
+      memset(kpage, 0, PGSIZE);
     break;
   case FILE_PAGE:
-    if (!was_holding_lock) lock_acquire(&file_lock);
+    lock_acquire(&file_lock);
 
     // almost same code at #else part at load_segment
     if (file_read_at(e->file, kpage, e->read_bytes, e->file_offset) != (int)e->read_bytes)
@@ -164,33 +358,407 @@ bool load_page(struct hash *spt, void *upage)
       falloc_free_page(kpage);
       lock_release(&file_lock);
       //printf("load_page file error");
-      sys_exit(-1);
+      return false;
     }
     memset(kpage + e->read_bytes, 0, e->zero_bytes);
+    file_fault_cnt++;
+    fault_around(spt, e);
   
-    if (!was_holding_lock) lock_release(&file_lock);
+    lock_release(&file_lock);
     break;
 
   case FRAME_PAGE:
     // is already loaded.
+    falloc_free_page(kpage);
     return true;
   }
 
-  pagedir = thread_current()->pagedir;
   /* Add the page to the process's address space. */
   if (!pagedir_set_page(pagedir, upage, kpage, e->writable))
   {
+    if (swap_id != -1)
+    {
+      /* The slot is gone, and the process with it. */
+      e->status = ZERO_PAGE;
+      e->kpage = NULL;
+    }
     falloc_free_page(kpage);
     //printf("load_page pagedir set fail");
-    sys_exit(-1);
+    return false;
   }
 
+  /* Only dirty file pages go to swap, so keep it dirty, or
+   * eviction would drop it as a clean copy of the file. */
+  if (swap_id != -1)
+    pagedir_set_dirty(pagedir, upage, true);
+  if (e->status == FILE_PAGE && !e->writable)
+    frame_cache_page(kpage, e);
   e->kpage = kpage;
   e->status = FRAME_PAGE;
+  falloc_unpin(kpage);
+
+  return true;
+}
+
+/* Back the 4 MB around UPAGE with a huge page, if UPAGE's VMA is
+ *  writable, is neither the stack nor a file mapping and covers
+ *  all of it, and none of those pages has been touched yet.  File
+ *  mappings keep 4 kB pages so that munmap() and msync() can write
+ *  back and drop each page without splitting.  Segment contents
+ *  are read in one go and the rest is zeroed.  Every page still
+ *  gets an spte, so that the huge page can later be split into
+ *  ordinary frames.  Returns false to fall back to 4 kB pages.
+ */
+static bool
+load_huge_page(struct hash *spt, void *upage)
+{
+  struct thread *t = thread_current();
+  struct vma *vma = vma_find(&t->vm_map, upage);
+  uint8_t *base = (uint8_t *) ((uintptr_t) upage & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+  uint32_t ofs, read_bytes = 0;
+  uint8_t *kpage;
+  size_t i;
+
+  if (vma == NULL || !vma->writable || vma->kind == VMA_STACK
+      || vma->kind == VMA_MMAP
+      || base < vma->start || vma->end - base < HUGE_PAGE_SIZE
+      || !pagedir_huge_page_free(t->pagedir, base))
+    return false;
+  for (i = 0; i < HUGE_PAGE_PAGES; i++)
+    if (get_spte(spt, base + i * PGSIZE) != NULL)
+      return false;
+
+  ofs = base - vma->start;
+  if (vma->file != NULL && ofs < vma->file_bytes)
+    read_bytes = vma->file_bytes - ofs < HUGE_PAGE_SIZE ? vma->file_bytes - ofs : HUGE_PAGE_SIZE;
+  kpage = falloc_get_huge(read_bytes == 0);
+  if (kpage == NULL)
+    return false;
+  if (read_bytes > 0)
+  {
+    off_t got;
+
+    lock_acquire(&file_lock);
+    got = file_read_at(vma->file, kpage, read_bytes, vma->file_ofs + ofs);
+    lock_release(&file_lock);
+    if (got != (off_t) read_bytes)
+    {
+      falloc_free_huge(kpage);
+      return false;
+    }
+    memset(kpage + read_bytes, 0, HUGE_PAGE_SIZE - read_bytes);
+  }
+
+  for (i = 0; i < HUGE_PAGE_PAGES; i++)
+  {
+    struct spte *e = spte_from_vma(spt, base + i * PGSIZE, false);
+    e->kpage = kpage + i * PGSIZE;
+    e->status = FRAME_PAGE;
+  }
+  if (!frame_install_huge(kpage, base, true))
+  {
+    frame_lock_acquire();
+    for (i = 0; i < HUGE_PAGE_PAGES; i++)
+    {
+      struct spte *e = get_spte(spt, base + i * PGSIZE);
+      hash_delete(spt, &e->hash_elem);
+      free(e);
+    }
+    frame_lock_release();
+    falloc_free_huge(kpage);
+    return false;
+  }
+  return true;
+}
+
+/* Bring the pages from START up to END that lie in a VMA into
+ *  memory ahead of use, for madvise(MADV_WILLNEED) and
+ *  MAP_POPULATE.  Zero pages are left to their first fault.
+ *  Stops early when memory runs out.  Returns the number of pages
+ *  loaded.
+ */
+size_t prefault_pages(struct hash *spt, void *start, void *end)
+{
+  uint8_t *upage;
+  size_t cnt = 0;
+
+  for (upage = start; upage < (uint8_t *) end; upage += PGSIZE)
+  {
+    struct spte *e = get_spte(spt, upage);
+    if (e == NULL)
+      e = spte_from_vma(spt, upage, true);
+    if (e == NULL || e->status == FRAME_PAGE || e->status == ZERO_PAGE)
+      continue;
+    if (!load_spte(spt, e, false))
+      break;
+    cnt++;
+  }
+  return cnt;
+}
+
+/* Fault-around for FILE_PAGE faults.
+ *  Maps the other not-yet-loaded pages of E's file in a window
+ *  around E, so that a program touching its text or an mmap'd
+ *  file page by page takes one fault per window instead of one
+ *  per page.  Only free frames are used: fault-around never
+ *  evicts.  Nor does it wait for the disk: only neighbours whose
+ *  sectors are all in the buffer cache are mapped, and the rest
+ *  are handed to the cache's read-ahead thread, so that a later
+ *  fault finds them there.  When a fault lands right after the previous window,
+ *  the access is sequential, so the window doubles (up to
+ *  FAULT_AROUND_MAX) and is placed ahead of the fault.
+ *  Otherwise it falls back to fault_around_pages, aligned around
+ *  the fault.  madvise() advice on the VMA overrides this:
+ *  MADV_RANDOM turns fault-around off and MADV_SEQUENTIAL always
+ *  uses the largest window.  Caller must hold file_lock.
+ */
+static void
+fault_around(struct hash *spt, struct spte *e)
+{
+  struct thread *t = thread_current();
+  struct vma *vma = vma_find(&t->vm_map, e->upage);
+  uint8_t *start, *end, *upage;
+  size_t window;
+
+  if (fault_around_pages <= 1 || (vma != NULL && vma->advice == MADV_RANDOM))
+    return;
+
+  if (vma != NULL && vma->advice == MADV_SEQUENTIAL)
+  {
+    window = FAULT_AROUND_MAX;
+    start = e->upage;
+    drop_behind(spt, vma, e->upage);
+  }
+  else if (t->ra_next == e->upage && t->ra_window != 0)
+  {
+    window = t->ra_window * 2;
+    if (window > FAULT_AROUND_MAX)
+      window = FAULT_AROUND_MAX;
+    start = e->upage;
+  }
+  else
+  {
+    window = fault_around_pages;
+    start = (uint8_t *) e->upage - pg_no(e->upage) % window * PGSIZE;
+  }
+  end = start + window * PGSIZE;
+  t->ra_window = window;
+  t->ra_next = end;
+
+  for (upage = start; upage < end && is_user_vaddr(upage); upage += PGSIZE)
+  {
+    struct spte *n;
+    struct inode *inode;
+    void *kpage;
+
+    if (upage == e->upage)
+      continue;
+    n = get_spte(spt, upage);
+    if (n == NULL)
+      n = spte_from_vma(spt, upage, true);
+    if (n == NULL || n->status != FILE_PAGE || n->file != e->file
+        || n->writable != e->writable)
+      continue;
+    if (!n->writable && frame_map_cached(n))
+      continue;
+    inode = file_get_inode(n->file);
+    if (!inode_cached(inode, n->file_offset, n->read_bytes))
+    {
+      inode_read_ahead(inode, n->file_offset, n->read_bytes);
+      continue;
+    }
+
+    kpage = falloc_get_free_page(PAL_USER, upage);
+    if (kpage == NULL)
+      break;
+    if (file_read_at(n->file, kpage, n->read_bytes, n->file_offset) != (int)n->read_bytes)
+    {
+      falloc_free_page(kpage);
+      break;
+    }
+    memset(kpage + n->read_bytes, 0, n->zero_bytes);
+    if (!pagedir_set_page(t->pagedir, upage, kpage, n->writable))
+    {
+      falloc_free_page(kpage);
+      break;
+    }
+    if (!n->writable)
+      frame_cache_page(kpage, n);
+    n->kpage = kpage;
+    n->status = FRAME_PAGE;
+    falloc_unpin(kpage);
+    fault_around_cnt++;
+  }
+}
+
+/* Copy the VMAs and supplemental page table of PARENT into
+ *  CHILD's for fork().  Loaded pages are shared copy-on-write: the frame
+ *  is mapped read-only in both page tables and the first write
+ *  copies it.  Swapped-out pages share their swap slot, and file
+ *  and zero pages are copied as they are.  CHILD's executable and
+ *  mmap list must already mirror PARENT's.  Caller must hold the
+ *  frame lock.  Returns false if out of memory.
+ */
+bool fork_spt(struct thread *child, struct thread *parent)
+{
+  struct hash_iterator i;
+  struct list_elem *l;
+
+  for (l = list_begin(&parent->vm_map.vmas); l != list_end(&parent->vm_map.vmas);
+       l = list_next(l))
+  {
+    struct vma *v = list_entry(l, struct vma, elem);
+    struct vma *cv = vma_add(&child->vm_map, v->start, v->end, v->kind,
+                             fork_file(child, parent, v->file), v->file_ofs,
+                             v->file_bytes, v->writable);
+    if (cv == NULL)
+      return false;
+    cv->advice = v->advice;
+  }
+
+  hash_first(&i, &parent->spt);
+  while (hash_next(&i))
+  {
+    struct spte *pe = hash_entry(hash_cur(&i), struct spte, hash_elem);
+    struct spte *ce = malloc(sizeof *ce);
+    if (ce == NULL)
+      return false;
+    *ce = *pe;
+    ce->file = fork_file(child, parent, pe->file);
 
+    switch (pe->status)
+    {
+    case FRAME_PAGE:
+      if (!pagedir_set_page(child->pagedir, pe->upage, pe->kpage, false))
+      {
+        free(ce);
+        return false;
+      }
+      if (!frame_share(pe->kpage, child, pe->upage))
+      {
+        pagedir_clear_page(child->pagedir, pe->upage);
+        free(ce);
+        return false;
+      }
+      if (pe->writable)
+        pagedir_set_writable(parent->pagedir, pe->upage, false);
+      break;
+    case SWAP_PAGE:
+      swap_dup(pe->swap_id);
+      child->swap_pages++;
+      break;
+    case ZERO_PAGE:
+      /* The child maps the zero frame again on its first read. */
+      ce->kpage = NULL;
+      break;
+    default:
+      break;
+    }
+    hash_insert(&child->spt, &ce->hash_elem);
+  }
   return true;
 }
 
+/* Returns CHILD's copy of PARENT's file F, which is either the
+ *  executable or the file of one of PARENT's mmaps. */
+static struct file *
+fork_file(struct thread *child, struct thread *parent, struct file *f)
+{
+  struct list_elem *p, *c;
+
+  if (f == NULL)
+    return NULL;
+  if (f == parent->executing_file)
+    return child->executing_file;
+  for (p = list_begin(&parent->mmap_list), c = list_begin(&child->mmap_list);
+       p != list_end(&parent->mmap_list); p = list_next(p), c = list_next(c))
+    if (list_entry(p, struct mmap_file, mmap_file_elem)->file == f)
+      return list_entry(c, struct mmap_file, mmap_file_elem)->file;
+  return NULL;
+}
+
+/* Write fault on a present page: if UPAGE is a writable page
+ *  still shared copy-on-write, or mapped to the zero frame, give
+ *  the current thread its own copy.  Returns false for a genuine
+ *  protection fault.
+ *  usage: page_fault at userprog/exception.c
+ */
+bool cow_page(struct hash *spt, void *upage)
+{
+  struct spte *e = get_spte(spt, upage);
+  if (e == NULL || !e->writable)
+    return false;
+  if (e->status == ZERO_PAGE)
+    return e->kpage == zero_frame && unshare_zero_page(e);
+  return frame_cow(e);
+}
+
+/* Replaces the zero frame mapped at E with a private zeroed
+ *  frame, on the first write to the page. */
+static bool
+unshare_zero_page(struct spte *e)
+{
+  uint32_t *pd = thread_current()->pagedir;
+  void *kpage = falloc_get_page(PAL_USER | PAL_ZERO, e->upage);
+
+  if (kpage == NULL)
+    return false;
+  pagedir_clear_page(pd, e->upage);
+  if (!pagedir_set_page(pd, e->upage, kpage, true))
+  {
+    falloc_free_page(kpage);
+    return false;
+  }
+  e->kpage = kpage;
+  e->status = FRAME_PAGE;
+  zero_unshare_cnt++;
+  falloc_unpin(kpage);
+  return true;
+}
+
+/* MADV_SEQUENTIAL: release clean pages of VMA more than one
+ *  maximal window behind UPAGE, which a sequential reader is done
+ *  with, so that streaming through a large mapping does not push
+ *  other pages out.  Looks at one window's worth of pages.
+ */
+static void
+drop_behind(struct hash *spt, struct vma *vma, uint8_t *upage)
+{
+  uint32_t *pd = thread_current()->pagedir;
+  size_t span = FAULT_AROUND_MAX * PGSIZE;
+  size_t ofs = upage - vma->start;
+  uint8_t *lo, *hi, *p;
+
+  if (ofs < span)
+    return;
+  hi = upage - span;
+  lo = ofs >= 2 * span ? hi - span : vma->start;
+  for (p = lo; p < hi; p += PGSIZE)
+  {
+    struct spte *n = get_spte(spt, p);
+    if (n != NULL && n->status == FRAME_PAGE && !pagedir_is_dirty(pd, p)
+        && page_delete(spt, n))
+      drop_behind_cnt++;
+  }
+}
+
+/* Prints fault-around statistics. */
+void
+fault_around_print_stats(void)
+{
+  printf("Fault-around: %zu file faults, %zu pages mapped around them, "
+         "%zu dropped behind\n",
+         file_fault_cnt, fault_around_cnt, drop_behind_cnt);
+}
+
+/* Prints shared zero page statistics. */
+void
+zero_page_print_stats(void)
+{
+  printf("Zero page: %zu read faults shared, %zu unshared on write\n",
+         zero_map_cnt, zero_unshare_cnt);
+}
+
 /* search given upage within spt. */
 struct spte *
 get_spte(struct hash *spt, void *upage)
@@ -203,9 +771,58 @@ get_spte(struct hash *spt, void *upage)
   else return hash_entry(elem, struct spte, hash_elem);
 }
 
-/* delete page */
-void page_delete(struct hash *spt, struct spte *entry)
+/* delete page, releasing its frame if it is loaded.  A page of a
+ *  huge page splits it first.  Returns false, leaving the page in
+ *  place, if the huge page cannot be split for lack of memory;
+ *  destroy_spt() frees it with the rest of the huge page when the
+ *  process exits.  This runs from process_exit() through
+ *  sys_munmap(), so it must not exit.  The status is rechecked
+ *  under frame_lock, since eviction or the OOM killer may have
+ *  taken the frame or the swap slot in the meantime. */
+bool page_delete(struct hash *spt, struct spte *entry)
 {
+  if (entry->status == FRAME_PAGE && !frame_split_huge(thread_current(), entry->upage))
+    return false;
+  frame_lock_acquire();
+  if (entry->status == FRAME_PAGE)
+    falloc_free_page_locked(entry->kpage);
+  else if (entry->status == SWAP_PAGE)
+  {
+    swap_free(entry->swap_id);
+    thread_current()->swap_pages--;
+  }
+  else if (entry->kpage == zero_frame)
+    pagedir_clear_page(thread_current()->pagedir, entry->upage);
   hash_delete(spt, &entry->hash_elem);
+  frame_lock_release();
   free(entry);
-}
\ No newline at end of file
+  return true;
+}
+
+/* Frees T's swap slots for the OOM killer, turning its swapped
+ *  pages into zero pages.  Swapped pages of files hold dirty data
+ *  that T's exit may still write back, so they are kept.  Caller
+ *  must hold frame_lock, which keeps T from changing its table or
+ *  swapping a page in meanwhile.  Returns the number of pages
+ *  released.
+ */
+size_t spt_reclaim_swap(struct thread *t)
+{
+  struct hash_iterator i;
+  size_t cnt = 0;
+
+  hash_first(&i, &t->spt);
+  while (hash_next(&i))
+  {
+    struct spte *e = hash_entry(hash_cur(&i), struct spte, hash_elem);
+    if (e->status == SWAP_PAGE && e->file == NULL)
+    {
+      swap_free(e->swap_id);
+      e->status = ZERO_PAGE;
+      e->kpage = NULL;
+      cnt++;
+    }
+  }
+  t->swap_pages -= cnt;
+  return cnt;
+}
@@ -6,6 +6,16 @@
 #include "filesys/off_t.h"
 #include "userprog/syscall.h"
 
+/* Pages mapped per FILE_PAGE fault, counting the faulting page,
+   unless the faults look sequential.  Set with "-fault-around";
+   1 maps only the faulting page. */
+#define FAULT_AROUND_DEFAULT 16
+
+/* Largest window sequential faults grow the fault-around to. */
+#define FAULT_AROUND_MAX 128
+
+extern size_t fault_around_pages;
+
 enum spt_status{
     ZERO_PAGE,
     FRAME_PAGE,
@@ -32,9 +42,17 @@ void init_spt (struct hash *);
 void destroy_spt (struct hash *);
 void init_frame_spte (struct hash *, void *, void *);
 struct spte *init_file_spte (struct hash *, void *, struct file *, off_t, uint32_t, uint32_t, bool);
-void init_zero_spte (struct hash *spt, void *upage);
-bool load_page (struct hash *, void *);
+struct spte *init_zero_spte (struct hash *spt, void *upage);
+bool load_page (struct hash *, void *, bool write);
+size_t prefault_pages (struct hash *, void *start, void *end);
+bool pin_user_pages (const void *start, size_t size, bool write);
+void unpin_user_pages (const void *start, size_t size);
 struct spte *get_spte (struct hash *, void *);
-void page_delete (struct hash *spt, struct spte *entry);
+bool page_delete (struct hash *spt, struct spte *entry);
+void fault_around_print_stats (void);
+void zero_page_print_stats (void);
+bool fork_spt (struct thread *child, struct thread *parent);
+bool cow_page (struct hash *, void *);
+size_t spt_reclaim_swap (struct thread *);
 
 #endif
\ No newline at end of file
@@ -1,43 +1,151 @@
 #include "vm/swap.h"
 #include <bitmap.h>
+#include <debug.h>
 #include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include <stdio.h>
 #include "threads/vaddr.h"
+#include "vm/zswap.h"
 
 #define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
 
+static void swap_release(int swap_index);
+
 static struct lock swap_lock;
 static struct bitmap *swap_valid_table;
 static struct block *swap_disk;
 
+/* Number of page table entries referring to each slot.  More
+   than one after fork() shares a swapped-out page. */
+static uint16_t *swap_ref_cnt;
+
+/* Next-fit cursor: swap_out() searches from the slot after the
+   last one it took, instead of from slot 0 every time. */
+static size_t swap_cursor;
+
+/* Swap statistics. */
+static size_t swap_used;          /* Slots in use. */
+static size_t swap_peak;          /* Most slots ever in use. */
+static long long swap_out_cnt;    /* Pages written out. */
+static long long swap_in_cnt;     /* Pages read back in. */
+static long long swap_drop_cnt;   /* Slots freed without reading. */
+
 void init_swap_table() {
+  size_t slot_cnt;
+
   swap_disk = block_get_role(BLOCK_SWAP);
-  swap_valid_table = bitmap_create(block_size(swap_disk) / SECTORS_PER_PAGE);
+  slot_cnt = swap_disk != NULL ? block_size(swap_disk) / SECTORS_PER_PAGE : 0;
+  swap_valid_table = bitmap_create(slot_cnt);
   bitmap_set_all(swap_valid_table, true);
+  swap_ref_cnt = calloc(slot_cnt, sizeof *swap_ref_cnt);
 
   lock_init(&swap_lock);
 }
 
+/* Reads swap slot SWAP_INDEX into KPAGE, from the compressed
+   pool if it is still there, and drops a reference to the slot,
+   freeing it with the last one. */
 void swap_in(int swap_index, void *kpage) {
-  lock_acquire(&swap_lock);
-
-  for (int i = 0; i < SECTORS_PER_PAGE; i++) {
-    block_read(swap_disk, swap_index * SECTORS_PER_PAGE + i, kpage + i * BLOCK_SECTOR_SIZE);
+  if (!zswap_load(swap_index, kpage)) {
+    for (int i = 0; i < SECTORS_PER_PAGE; i++) {
+      block_read(swap_disk, swap_index * SECTORS_PER_PAGE + i, kpage + i * BLOCK_SECTOR_SIZE);
+    }
   }
 
-  bitmap_set(swap_valid_table, swap_index, true);
+  swap_in_cnt++;
+  swap_release(swap_index);
+}
+
+/* Drops a reference to swap slot SWAP_INDEX without reading it,
+   for a swapped-out page that is unmapped or whose process
+   exits.  Frees the slot with the last reference. */
+void swap_free(int swap_index) {
+  swap_drop_cnt++;
+  swap_release(swap_index);
+}
 
+/* Drops a reference to swap slot SWAP_INDEX, freeing the slot
+   with the last one. */
+static void swap_release(int swap_index) {
+  lock_acquire(&swap_lock);
+  ASSERT(swap_ref_cnt[swap_index] > 0);
+  if (--swap_ref_cnt[swap_index] == 0) {
+    zswap_invalidate(swap_index);
+    bitmap_set(swap_valid_table, swap_index, true);
+    swap_used--;
+  }
   lock_release(&swap_lock);
 }
 
+/* Reserves a swap slot for KPAGE and returns its index.  The page
+   goes to the compressed pool if it fits, to disk otherwise.
+   Callers check swap_free_cnt() first: swap must not be full. */
 int swap_out(void *kpage) {
   lock_acquire(&swap_lock);
+  size_t swap_index = bitmap_scan_and_flip(swap_valid_table, swap_cursor, 1, true);
+  if (swap_index == BITMAP_ERROR)
+    swap_index = bitmap_scan_and_flip(swap_valid_table, 0, 1, true);
+  if (swap_index == BITMAP_ERROR)
+    PANIC("swap_out: no free swap slot");
+  swap_cursor = swap_index + 1;
+  swap_ref_cnt[swap_index] = 1;
+  if (++swap_used > swap_peak)
+    swap_peak = swap_used;
+  swap_out_cnt++;
+  lock_release(&swap_lock);
 
-  int swap_index = bitmap_scan_and_flip(swap_valid_table, 0, 1, true);
+  if (!zswap_store(swap_index, kpage))
+    swap_write_slot(swap_index, kpage);
+  return swap_index;
+}
 
+/* Writes KPAGE to swap slot SWAP_INDEX on the swap device. */
+void swap_write_slot(int swap_index, const void *kpage) {
   for (int i = 0; i < SECTORS_PER_PAGE; i++) {
     block_write(swap_disk, swap_index * SECTORS_PER_PAGE + i, kpage + i * BLOCK_SECTOR_SIZE);
   }
+}
 
+/* Adds a reference to swap slot SWAP_INDEX, for fork(). */
+void swap_dup(int swap_index) {
+  lock_acquire(&swap_lock);
+  ASSERT(swap_ref_cnt[swap_index] > 0);
+  swap_ref_cnt[swap_index]++;
   lock_release(&swap_lock);
-  return swap_index;
+}
+
+/* Returns the number of swap slots. */
+size_t swap_slot_cnt(void) {
+  return bitmap_size(swap_valid_table);
+}
+
+/* Returns the number of free swap slots. */
+size_t swap_free_cnt(void) {
+  return bitmap_size(swap_valid_table) - swap_used;
+}
+
+/* Prints swap statistics.  Fragmentation is the share of free
+   slots that lie in holes below the highest slot in use, split
+   into that many runs. */
+void swap_print_stats(void) {
+  size_t slot_cnt = bitmap_size(swap_valid_table);
+  size_t top = 0, holes = 0, runs = 0, i;
+
+  lock_acquire(&swap_lock);
+  for (i = 0; i < slot_cnt; i++)
+    if (!bitmap_test(swap_valid_table, i))
+      top = i + 1;
+  for (i = 0; i < top; i++)
+    if (bitmap_test(swap_valid_table, i)) {
+      holes++;
+      if (i == 0 || !bitmap_test(swap_valid_table, i - 1))
+        runs++;
+    }
+  lock_release(&swap_lock);
+
+  printf("Swap: %zu of %zu slots used, peak %zu; %lld pages out, %lld in, "
+         "%lld dropped; %zu free slots in %zu holes below slot %zu\n",
+         swap_used, slot_cnt, swap_peak, swap_out_cnt, swap_in_cnt,
+         swap_drop_cnt, holes, runs, top);
 }
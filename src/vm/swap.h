@@ -1,8 +1,16 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+#include <stddef.h>
+
 void init_swap_table(void);
 void swap_in(int swap_index, void *kpage);
 int swap_out(void *kpage);
+void swap_write_slot(int swap_index, const void *kpage);
+void swap_free(int swap_index);
+void swap_dup(int swap_index);
+size_t swap_slot_cnt(void);
+size_t swap_free_cnt(void);
+void swap_print_stats(void);
 
-#endif
\ No newline at end of file
+#endif
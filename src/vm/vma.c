@@ -0,0 +1,162 @@
+#include "vm/vma.h"
+#include <debug.h>
+#include <syscall-nr.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+/* Initializes MAP as an empty address space. */
+void
+vma_map_init (struct vm_map *map)
+{
+  list_init (&map->vmas);
+  map->hint = NULL;
+}
+
+/* Frees all of MAP's VMAs.  Does not close their files. */
+void
+vma_map_destroy (struct vm_map *map)
+{
+  while (!list_empty (&map->vmas))
+    free (list_entry (list_pop_front (&map->vmas), struct vma, elem));
+  map->hint = NULL;
+}
+
+/* Adds a VMA for the pages from START up to END to MAP.  Returns
+   the new VMA, or a null pointer if the range is empty, overlaps
+   an existing VMA, or memory is short. */
+struct vma *
+vma_add (struct vm_map *map, void *start, void *end, enum vma_kind kind,
+         struct file *file, off_t file_ofs, uint32_t file_bytes,
+         bool writable)
+{
+  struct list_elem *e;
+  struct vma *vma;
+
+  ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+  if (start >= end || vma_overlaps (map, start, end))
+    return NULL;
+
+  vma = malloc (sizeof *vma);
+  if (vma == NULL)
+    return NULL;
+  vma->start = start;
+  vma->end = end;
+  vma->kind = kind;
+  vma->file = file;
+  vma->file_ofs = file_ofs;
+  vma->file_bytes = file_bytes;
+  vma->writable = writable;
+  vma->advice = MADV_NORMAL;
+
+  for (e = list_begin (&map->vmas); e != list_end (&map->vmas);
+       e = list_next (e))
+    if (list_entry (e, struct vma, elem)->start > vma->start)
+      break;
+  list_insert (e, &vma->elem);
+  return vma;
+}
+
+/* Removes VMA from MAP and frees it. */
+void
+vma_remove (struct vm_map *map, struct vma *vma)
+{
+  if (map->hint == vma)
+    map->hint = NULL;
+  list_remove (&vma->elem);
+  free (vma);
+}
+
+/* Returns the VMA in MAP that contains ADDR, or a null pointer
+   if ADDR is not in any.  Faults tend to hit the same VMA
+   repeatedly, so the last one found is tried first. */
+struct vma *
+vma_find (struct vm_map *map, const void *addr)
+{
+  struct list_elem *e;
+
+  if (map->hint != NULL
+      && (const uint8_t *) addr >= map->hint->start
+      && (const uint8_t *) addr < map->hint->end)
+    return map->hint;
+
+  for (e = list_begin (&map->vmas); e != list_end (&map->vmas);
+       e = list_next (e))
+    {
+      struct vma *vma = list_entry (e, struct vma, elem);
+      if ((const uint8_t *) addr < vma->start)
+        break;
+      if ((const uint8_t *) addr < vma->end)
+        {
+          map->hint = vma;
+          return vma;
+        }
+    }
+  return NULL;
+}
+
+/* Returns true if any VMA in MAP overlaps START...END. */
+bool
+vma_overlaps (struct vm_map *map, const void *start, const void *end)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&map->vmas); e != list_end (&map->vmas);
+       e = list_next (e))
+    {
+      struct vma *vma = list_entry (e, struct vma, elem);
+      if ((const uint8_t *) end <= vma->start)
+        break;
+      if ((const uint8_t *) start < vma->end)
+        return true;
+    }
+  return false;
+}
+
+/* Extends MAP's stack VMA down to UPAGE.  Returns false if there
+   is no stack VMA or another VMA is in the way. */
+bool
+vma_grow_stack (struct vm_map *map, void *upage)
+{
+  struct list_elem *e;
+  struct vma *stack = NULL, *below = NULL;
+
+  for (e = list_begin (&map->vmas); e != list_end (&map->vmas);
+       e = list_next (e))
+    {
+      struct vma *vma = list_entry (e, struct vma, elem);
+      if (vma->kind == VMA_STACK)
+        {
+          stack = vma;
+          break;
+        }
+      below = vma;
+    }
+  if (stack == NULL)
+    return false;
+  if ((uint8_t *) upage >= stack->start)
+    return true;
+  if (below != NULL && (uint8_t *) upage < below->end)
+    return false;
+  stack->start = upage;
+  return true;
+}
+
+/* Sets the madvise() ADVICE of every VMA in MAP that overlaps
+   START...END.  VMAs are not split, so the advice applies to the
+   whole of each. */
+void
+vma_set_advice (struct vm_map *map, const void *start, const void *end,
+                int advice)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&map->vmas); e != list_end (&map->vmas);
+       e = list_next (e))
+    {
+      struct vma *vma = list_entry (e, struct vma, elem);
+      if ((const uint8_t *) end <= vma->start)
+        break;
+      if ((const uint8_t *) start < vma->end)
+        vma->advice = advice;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+
+/* What a virtual memory area was created for. */
+enum vma_kind
+  {
+    VMA_SEGMENT,                /* ELF segment. */
+    VMA_MMAP,                   /* mmap() of a file. */
+    VMA_STACK                   /* User stack; grows down. */
+  };
+
+/* How far below PHYS_BASE the user stack may grow. */
+#define MAX_STACK_SIZE 0x800000 // 8MB
+
+/* A virtual memory area: a page-aligned range of user addresses
+   with the same backing.  Pages are backed by FILE from FILE_OFS
+   for the first FILE_BYTES bytes of the range and are zero after
+   that; anonymous areas have no file.  Per-page state (struct
+   spte) is created from the area on the first fault. */
+struct vma
+  {
+    uint8_t *start;             /* First page. */
+    uint8_t *end;               /* One past the last page. */
+    enum vma_kind kind;
+    struct file *file;          /* Backing file, or null. */
+    off_t file_ofs;             /* Offset in FILE of START. */
+    uint32_t file_bytes;        /* Bytes of the range backed by FILE. */
+    bool writable;
+    int advice;                 /* MADV_NORMAL, _RANDOM or _SEQUENTIAL. */
+    struct list_elem elem;      /* In struct vm_map's list. */
+  };
+
+/* A process's VMAs, sorted by address. */
+struct vm_map
+  {
+    struct list vmas;
+    struct vma *hint;           /* Last VMA found, checked first. */
+  };
+
+void vma_map_init (struct vm_map *);
+void vma_map_destroy (struct vm_map *);
+struct vma *vma_add (struct vm_map *, void *start, void *end,
+                     enum vma_kind, struct file *, off_t file_ofs,
+                     uint32_t file_bytes, bool writable);
+void vma_remove (struct vm_map *, struct vma *);
+struct vma *vma_find (struct vm_map *, const void *addr);
+bool vma_overlaps (struct vm_map *, const void *start, const void *end);
+bool vma_grow_stack (struct vm_map *, void *upage);
+void vma_set_advice (struct vm_map *, const void *start, const void *end,
+                     int advice);
+
+#endif /* vm/vma.h */
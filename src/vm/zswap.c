@@ -0,0 +1,483 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* Compressed swap cache.
+
+   swap_out() hands every page it is given to zswap_store() before
+   touching the swap device.  The page is compressed with a small
+   LZ77 coder and kept in a bounded pool of kernel pages.  Each
+   pool page holds at most two compressed pages ("buddies"), one
+   packed against the start of the page and one against its end,
+   so allocation is a short scan and freeing never needs
+   compaction.
+
+   swap_out() still reserves a slot on the swap device for every
+   page, so the pool never has to find room on disk.  When the
+   pool is full, the oldest compressed pages are decompressed and
+   written to the slots reserved for them.  Only those pages ever
+   cost a disk write. */
+
+/* Compressed pages bigger than this are written straight to disk. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/* A page of the compressed pool. */
+struct zpage
+  {
+    uint8_t *kpage;                     /* Kernel page holding the data. */
+    struct zentry *first;               /* Entry at the start of KPAGE. */
+    struct zentry *last;                /* Entry at the end of KPAGE. */
+    struct list_elem elem;              /* Element in zpage_list. */
+  };
+
+/* A compressed page. */
+struct zentry
+  {
+    int swap_index;                     /* Swap slot reserved for it. */
+    struct zpage *zpage;                /* Pool page holding the data. */
+    size_t size;                        /* Compressed size in bytes. */
+    struct hash_elem hash_elem;         /* Element in zentry_table. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+  };
+
+static struct lock zswap_lock;
+static struct hash zentry_table;        /* Entries by swap slot. */
+static struct list lru_list;            /* Entries, oldest first. */
+static struct list zpage_list;          /* Pages of the pool. */
+static size_t pool_limit;               /* Maximum pool pages. */
+static size_t pool_pages;               /* Current pool pages. */
+
+/* Scratch buffers, protected by zswap_lock. */
+static uint8_t compress_buf[ZSWAP_MAX_SIZE];
+static uint8_t writeback_buf[PGSIZE];
+
+/* Statistics. */
+static size_t store_cnt;                /* Pages accepted into the pool. */
+static size_t reject_cnt;               /* Pages sent straight to disk. */
+static size_t hit_cnt;                  /* swap_in()s served from the pool. */
+static size_t miss_cnt;                 /* swap_in()s that went to disk. */
+static size_t writeback_cnt;            /* Pool pages written to disk. */
+static size_t avoided_cnt;              /* Pool pages never written. */
+static uint64_t compressed_bytes;       /* Total size after compression. */
+
+static hash_hash_func zentry_hash;
+static hash_less_func zentry_less;
+static size_t lz_compress (const uint8_t *, uint8_t *, size_t out_max);
+static size_t lz_decompress (const uint8_t *, size_t, uint8_t *,
+                             size_t out_max);
+
+/* Initializes the compressed swap cache with a pool of at most
+   POOL_PAGES kernel pages.  A POOL_PAGES of 0 disables it. */
+void
+zswap_init (size_t pool_pages_)
+{
+  lock_init (&zswap_lock);
+  hash_init (&zentry_table, zentry_hash, zentry_less, NULL);
+  list_init (&lru_list);
+  list_init (&zpage_list);
+  pool_limit = pool_pages_;
+  pool_pages = 0;
+}
+
+/* Returns the entry for SWAP_INDEX, or a null pointer if that
+   slot is not in the pool. */
+static struct zentry *
+zentry_lookup (int swap_index)
+{
+  struct zentry key;
+  struct hash_elem *e;
+
+  key.swap_index = swap_index;
+  e = hash_find (&zentry_table, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct zentry, hash_elem) : NULL;
+}
+
+/* Returns the address of E's compressed data. */
+static uint8_t *
+zentry_data (const struct zentry *e)
+{
+  if (e->zpage->first == e)
+    return e->zpage->kpage;
+  else
+    return e->zpage->kpage + PGSIZE - e->size;
+}
+
+/* Returns the number of bytes in ZP not used by either buddy. */
+static size_t
+zpage_free_bytes (const struct zpage *zp)
+{
+  size_t used = 0;
+  if (zp->first != NULL)
+    used += zp->first->size;
+  if (zp->last != NULL)
+    used += zp->last->size;
+  return PGSIZE - used;
+}
+
+/* Removes E from the pool and frees it, along with its pool
+   page if that page becomes empty. */
+static void
+zentry_remove (struct zentry *e)
+{
+  struct zpage *zp = e->zpage;
+
+  hash_delete (&zentry_table, &e->hash_elem);
+  list_remove (&e->lru_elem);
+  if (zp->first == e)
+    zp->first = NULL;
+  else
+    zp->last = NULL;
+  free (e);
+
+  if (zp->first == NULL && zp->last == NULL)
+    {
+      list_remove (&zp->elem);
+      palloc_free_page (zp->kpage);
+      free (zp);
+      pool_pages--;
+    }
+}
+
+/* Writes the oldest entry in the pool to its swap slot and
+   removes it.  Returns false if the pool is empty. */
+static bool
+writeback_oldest (void)
+{
+  struct zentry *e;
+  size_t size;
+
+  if (list_empty (&lru_list))
+    return false;
+
+  e = list_entry (list_front (&lru_list), struct zentry, lru_elem);
+  size = lz_decompress (zentry_data (e), e->size, writeback_buf, PGSIZE);
+  ASSERT (size == PGSIZE);
+  swap_write_slot (e->swap_index, writeback_buf);
+  writeback_cnt++;
+  zentry_remove (e);
+  return true;
+}
+
+/* Returns a pool page with a free buddy of at least SIZE bytes,
+   growing the pool if it is below its limit.  Returns a null
+   pointer if no such page exists. */
+static struct zpage *
+find_zpage (size_t size)
+{
+  struct list_elem *e;
+  struct zpage *zp;
+
+  for (e = list_begin (&zpage_list); e != list_end (&zpage_list);
+       e = list_next (e))
+    {
+      zp = list_entry (e, struct zpage, elem);
+      if ((zp->first == NULL || zp->last == NULL)
+          && zpage_free_bytes (zp) >= size)
+        return zp;
+    }
+
+  if (pool_pages >= pool_limit)
+    return NULL;
+  zp = malloc (sizeof *zp);
+  if (zp == NULL)
+    return NULL;
+  zp->kpage = palloc_get_page (0);
+  if (zp->kpage == NULL)
+    {
+      free (zp);
+      return NULL;
+    }
+  zp->first = zp->last = NULL;
+  list_push_back (&zpage_list, &zp->elem);
+  pool_pages++;
+  return zp;
+}
+
+/* Compresses KPAGE into the pool as the contents of swap slot
+   SWAP_INDEX, writing older pool entries to disk if necessary to
+   make room.  Returns true if successful, false if the page
+   should be written to disk by the caller instead. */
+bool
+zswap_store (int swap_index, const void *kpage)
+{
+  struct zentry *e;
+  struct zpage *zp;
+  size_t size;
+
+  if (pool_limit == 0)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  ASSERT (zentry_lookup (swap_index) == NULL);
+
+  size = lz_compress (kpage, compress_buf, sizeof compress_buf);
+  e = size != 0 ? malloc (sizeof *e) : NULL;
+  if (e == NULL)
+    {
+      reject_cnt++;
+      lock_release (&zswap_lock);
+      return false;
+    }
+
+  while ((zp = find_zpage (size)) == NULL)
+    if (!writeback_oldest ())
+      {
+        free (e);
+        reject_cnt++;
+        lock_release (&zswap_lock);
+        return false;
+      }
+
+  e->swap_index = swap_index;
+  e->zpage = zp;
+  e->size = size;
+  if (zp->first == NULL)
+    zp->first = e;
+  else
+    zp->last = e;
+  memcpy (zentry_data (e), compress_buf, size);
+  hash_insert (&zentry_table, &e->hash_elem);
+  list_push_back (&lru_list, &e->lru_elem);
+
+  store_cnt++;
+  compressed_bytes += size;
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* If swap slot SWAP_INDEX is in the pool, decompresses it into
+   KPAGE and returns true.  Otherwise returns false, and the
+   caller must read the slot from disk.  The entry stays in the
+   pool until zswap_invalidate() is called for the slot. */
+bool
+zswap_load (int swap_index, void *kpage)
+{
+  struct zentry *e;
+  size_t size;
+
+  if (pool_limit == 0)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  e = zentry_lookup (swap_index);
+  if (e == NULL)
+    {
+      miss_cnt++;
+      lock_release (&zswap_lock);
+      return false;
+    }
+  size = lz_decompress (zentry_data (e), e->size, kpage, PGSIZE);
+  ASSERT (size == PGSIZE);
+  hit_cnt++;
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* Drops swap slot SWAP_INDEX from the pool, if it is there.
+   Called when the slot is freed. */
+void
+zswap_invalidate (int swap_index)
+{
+  struct zentry *e;
+
+  if (pool_limit == 0)
+    return;
+
+  lock_acquire (&zswap_lock);
+  e = zentry_lookup (swap_index);
+  if (e != NULL)
+    {
+      avoided_cnt++;
+      zentry_remove (e);
+    }
+  lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap cache statistics. */
+void
+zswap_print_stats (void)
+{
+  uint64_t original_bytes = (uint64_t) store_cnt * PGSIZE;
+
+  printf ("Zswap: %zu pages stored, %zu rejected, %"PRIu64" kB "
+          "compressed to %"PRIu64" kB (%"PRIu64"%%)\n",
+          store_cnt, reject_cnt, original_bytes / 1024,
+          compressed_bytes / 1024,
+          original_bytes != 0 ? compressed_bytes * 100 / original_bytes : 0);
+  printf ("Zswap: %zu pool hits, %zu misses, %zu writebacks, "
+          "%zu disk writes avoided\n",
+          hit_cnt, miss_cnt, writeback_cnt, avoided_cnt);
+}
+
+/* Returns a hash value for entry E. */
+static unsigned
+zentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct zentry, hash_elem)->swap_index);
+}
+
+/* Returns true if entry A precedes entry B. */
+static bool
+zentry_less (const struct hash_elem *a, const struct hash_elem *b,
+             void *aux UNUSED)
+{
+  return (hash_entry (a, struct zentry, hash_elem)->swap_index
+          < hash_entry (b, struct zentry, hash_elem)->swap_index);
+}
+
+/* LZ77 coder.
+
+   The output is a sequence of groups, each a flag byte followed
+   by up to 8 items.  Bit I of the flag byte, counting from the
+   least significant bit, says what item I is:
+
+        - 0: a literal byte, copied to the output as is.
+
+        - 1: a back reference, two or three bytes.  The low 4 bits
+          of the first byte and the whole second byte give the
+          distance back into the output, 1 to 4095.  The high 4
+          bits of the first byte give the length minus 3, except
+          that 15 means the length is 18 plus a third byte.
+
+   Matches are found through a hash table of the last position
+   at which each 3-byte prefix was seen, so compression is one
+   pass over the page.  Pages of zeros, the common case for stack
+   and BSS, shrink to a few dozen bytes. */
+
+#define LZ_HASH_BITS 10
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (18 + 255)
+#define LZ_MAX_OFFSET 4095
+
+/* Last position + 1 at which each hashed prefix was seen, or 0.
+   Protected by zswap_lock. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+/* Returns the hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p)
+{
+  uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the page at IN into OUT, which has room for OUT_MAX
+   bytes.  Returns the compressed size, or 0 if the page does not
+   compress to fewer than OUT_MAX bytes. */
+static size_t
+lz_compress (const uint8_t *in, uint8_t *out, size_t out_max)
+{
+  size_t ip = 0, op = 0;
+  size_t flag_ofs = 0;
+  int item = 8;
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (ip < PGSIZE)
+    {
+      size_t len = 0, dist = 0;
+
+      if (item == 8)
+        {
+          if (op >= out_max)
+            return 0;
+          flag_ofs = op++;
+          out[flag_ofs] = 0;
+          item = 0;
+        }
+
+      if (ip + LZ_MIN_MATCH <= PGSIZE)
+        {
+          unsigned h = lz_hash (in + ip);
+          size_t cand = lz_table[h];
+
+          lz_table[h] = ip + 1;
+          if (cand != 0 && ip - (cand - 1) <= LZ_MAX_OFFSET)
+            {
+              size_t max = PGSIZE - ip;
+              if (max > LZ_MAX_MATCH)
+                max = LZ_MAX_MATCH;
+              cand--;
+              dist = ip - cand;
+              while (len < max && in[cand + len] == in[ip + len])
+                len++;
+            }
+        }
+
+      if (len >= LZ_MIN_MATCH)
+        {
+          size_t code = len < 18 ? len - LZ_MIN_MATCH : 15;
+          if (op + (code == 15 ? 3 : 2) > out_max)
+            return 0;
+          out[flag_ofs] |= 1 << item;
+          out[op++] = (code << 4) | (dist >> 8);
+          out[op++] = dist & 0xff;
+          if (code == 15)
+            out[op++] = len - 18;
+          ip += len;
+        }
+      else
+        {
+          if (op >= out_max)
+            return 0;
+          out[op++] = in[ip++];
+        }
+      item++;
+    }
+  return op;
+}
+
+/* Decompresses the IN_SIZE bytes at IN into OUT, which has room
+   for OUT_MAX bytes.  Returns the number of bytes produced, or 0
+   if the input is malformed. */
+static size_t
+lz_decompress (const uint8_t *in, size_t in_size, uint8_t *out,
+               size_t out_max)
+{
+  size_t ip = 0, op = 0;
+
+  while (ip < in_size)
+    {
+      uint8_t flags = in[ip++];
+      int item;
+
+      for (item = 0; item < 8 && ip < in_size; item++)
+        if (flags & (1 << item))
+          {
+            size_t code, dist, len;
+
+            if (ip + 2 > in_size)
+              return 0;
+            code = in[ip] >> 4;
+            dist = ((in[ip] & 0x0f) << 8) | in[ip + 1];
+            ip += 2;
+            len = code + LZ_MIN_MATCH;
+            if (code == 15)
+              {
+                if (ip >= in_size)
+                  return 0;
+                len = 18 + in[ip++];
+              }
+            if (dist == 0 || dist > op || op + len > out_max)
+              return 0;
+            for (; len > 0; len--, op++)
+              out[op] = out[op - dist];
+          }
+        else
+          {
+            if (op >= out_max)
+              return 0;
+            out[op++] = in[ip++];
+          }
+    }
+  return op;
+}
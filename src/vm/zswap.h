@@ -0,0 +1,18 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Default size of the compressed pool, in kernel pages.
+   Overridden by the "-zswap=PAGES" kernel option; 0 disables the
+   compressed tier so that every swap_out() goes to disk. */
+#define ZSWAP_DEFAULT_PAGES 64
+
+void zswap_init (size_t pool_pages);
+bool zswap_store (int swap_index, const void *kpage);
+bool zswap_load (int swap_index, void *kpage);
+void zswap_invalidate (int swap_index);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */